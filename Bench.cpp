@@ -0,0 +1,218 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#include "Bench.h"
+#include "DeviceShadow.h"
+#include <esp_ota_ops.h>
+
+// Responses, filled by onFrameDecoded (NimBLE task), drained by runBench (loop)
+#define BENCH_RX_RING 32
+
+struct BenchRx {
+  uint32_t at;
+  uint16_t status;
+  uint16_t bytes;
+};
+
+static BenchRx benchRx[BENCH_RX_RING];
+static volatile uint32_t benchRxHead = 0;
+static volatile uint32_t benchRxTail = 0;
+static uint16_t benchCmd = 0;
+
+static void benchFrameHook(uint16_t cmd, uint16_t status, uint16_t payloadLen) {
+  if (cmd != benchCmd) return;  // Late answer to a command issued before the bench
+  if (benchRxHead - benchRxTail >= BENCH_RX_RING) return;  // Counted as timeout
+  BenchRx& r = benchRx[benchRxHead % BENCH_RX_RING];
+  r.at = micros();
+  r.status = status;
+  r.bytes = 10 + payloadLen;
+  benchRxHead = benchRxHead + 1;
+}
+
+static int compareU32(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Firmware identity: prefix of the app ELF SHA-256 (changes with every build,
+// unlike __DATE__/__TIME__ of a cached object file)
+static String buildId() {
+  char sha[17];
+  esp_app_get_elf_sha256(sha, sizeof(sha));
+  return String(sha);
+}
+
+void runBench(int count, int concurrency, int payloadLen, uint16_t cmd) {
+  if (count <= 0 || count > BENCH_MAX_COUNT) {
+    logOutput("Error: bench count must be 1-" + String(BENCH_MAX_COUNT) + ".");
+    return;
+  }
+  if (concurrency <= 0 || concurrency > BENCH_MAX_CONCURRENCY) {
+    logOutput("Error: bench concurrency must be 1-" + String(BENCH_MAX_CONCURRENCY) + ".");
+    return;
+  }
+  if (payloadLen < 0 || payloadLen > BENCH_MAX_PAYLOAD) {
+    logOutput("Error: bench payload must be 0-" + String(BENCH_MAX_PAYLOAD) + " bytes.");
+    return;
+  }
+  if (!activeTransport->isReady()) {
+    logOutput("Not ready/connected.");
+    return;
+  }
+  uint32_t* rtt = (uint32_t*)malloc(count * sizeof(uint32_t));
+  uint8_t* payload = (uint8_t*)malloc(payloadLen + 1);
+  if (!rtt || !payload) {
+    logOutput("Error: out of memory.");
+    free(rtt); free(payload);
+    return;
+  }
+  for (int i = 0; i < payloadLen; i++) payload[i] = (uint8_t)i;
+
+  logOutput("Bench: " + String(count) + " x cmd " + String(cmd) + " (" + String(payloadLen) + " B) x" +
+            String(concurrency) + " in flight via " + String(activeTransport->name()) + "...");
+  commQuiet = true;
+  benchRxHead = benchRxTail = 0;
+  benchCmd = cmd;
+  onFrameDecoded = benchFrameHook;
+
+  // Send times of in-flight commands (responses arrive in order)
+  uint32_t inflight[BENCH_MAX_CONCURRENCY];
+  int inHead = 0;
+  int inCount = 0;
+
+  int sent = 0;
+  int done = 0;
+  int errors = 0;
+  int writeFails = 0;
+  int timeouts = 0;
+  int abandoned = 0;
+  bool draining = false;
+  uint32_t drainStart = 0;
+  uint32_t rxBytes = 0;
+  const char* stopReason = "done";
+  uint32_t start = micros();
+  unsigned long startMs = millis();
+
+  while (done + errors + writeFails + timeouts + abandoned < count) {
+    // Serial, roster flushes and the state machine wait for us: allow a way out
+    if (Serial.available()) {
+      Serial.readStringUntil('\n');  // Consumed, not run as a command
+      stopReason = "abort";
+      break;
+    }
+    if (millis() - startMs > BENCH_MAX_RUN_MS) {
+      stopReason = "limit";
+      break;
+    }
+    if (!activeTransport->isReady()) {
+      stopReason = "link";
+      break;
+    }
+
+    // After a loss, FIFO matching is only safe again once the pipe is quiet
+    if (draining && micros() - drainStart > BENCH_TIMEOUT_MS * 1000UL) draining = false;
+
+    // Keep the pipe full
+    while (!draining && inCount < concurrency && sent < count) {
+      uint32_t t = micros();
+      sent++;
+      if (sendUltraCommand(cmd, payload, payloadLen)) {
+        inflight[(inHead + inCount) % BENCH_MAX_CONCURRENCY] = t;
+        inCount++;
+      } else {
+        writeFails++;
+      }
+    }
+
+    activeTransport->poll();
+
+    // Match responses to the oldest in-flight command
+    while (benchRxTail != benchRxHead) {
+      BenchRx r = benchRx[benchRxTail % BENCH_RX_RING];
+      benchRxTail = benchRxTail + 1;
+      if (draining) { drainStart = micros(); continue; }  // Late answer, wait for silence
+      if (inCount == 0) continue;
+      uint32_t t0 = inflight[inHead];
+      inHead = (inHead + 1) % BENCH_MAX_CONCURRENCY;
+      inCount--;
+      rxBytes += r.bytes;
+      if (r.status == STATUS_SUCCESS || r.status == STATUS_OK_CUSTOM || r.status == STATUS_LF_OK) {
+        rtt[done++] = r.at - t0;
+      } else {
+        errors++;
+      }
+    }
+
+    if (inCount > 0 && (micros() - inflight[inHead]) > BENCH_TIMEOUT_MS * 1000UL) {
+      inHead = (inHead + 1) % BENCH_MAX_CONCURRENCY;
+      inCount--;
+      timeouts++;
+      // A late answer would be matched to the wrong command: give up on the
+      // rest of the pipe and discard everything until one timeout of silence
+      abandoned += inCount;
+      inCount = 0;
+      draining = true;
+      drainStart = micros();
+    }
+    yield();
+  }
+  uint32_t elapsed = micros() - start;
+  abandoned += inCount;  // Still in flight when stopped early
+
+  onFrameDecoded = nullptr;
+  commQuiet = false;
+
+  // --- Results ---
+  float secs = elapsed / 1000000.0f;
+  float cmdRate = done / secs;
+  float byteRate = rxBytes / secs;
+  uint32_t rttMin = 0, rttMean = 0, rttP50 = 0, rttP99 = 0;
+  if (done > 0) {
+    qsort(rtt, done, sizeof(uint32_t), compareU32);
+    uint64_t sum = 0;
+    for (int i = 0; i < done; i++) sum += rtt[i];
+    rttMin = rtt[0];
+    rttMean = sum / done;
+    rttP50 = rtt[(done - 1) * 50 / 100];
+    rttP99 = rtt[(done - 1) * 99 / 100];
+  }
+
+  logOutput("Bench: " + String(cmdRate, 1) + " cmd/s  " + String(byteRate, 0) + " B/s notify  (" + String(secs, 2) + " s)");
+  logOutput("Bench: RTT min=" + String(rttMin) + "us mean=" + String(rttMean) + "us p50=" + String(rttP50) +
+            "us p99=" + String(rttP99) + "us");
+  logOutput("Bench: ok=" + String(done) + " errors=" + String(errors) + " write_fail=" + String(writeFails) +
+            " timeouts=" + String(timeouts) + " abandoned=" + String(abandoned) + " stop=" + stopReason);
+
+  // Single line for fleet comparison (key=value, stable order)
+  String fw = shadow.fwMajor == SHADOW_UNKNOWN ? String("?") : String(shadow.fwMajor) + "." + String(shadow.fwMinor);
+  String line = "BENCH v=2 build=" + buildId() + " transport=" + String(activeTransport->name()) + " dev_fw=" + fw;
+  if (activeTransport->isReady() && pClient && pClient->isConnected() && strcmp(activeTransport->name(), "BLE") == 0) {
+    NimBLEConnInfo info = pClient->getConnInfo();
+    line += " mtu=" + String(pClient->getMTU()) + " conn_itvl=" + String(info.getConnInterval()) +
+            " conn_lat=" + String(info.getConnLatency()) + " rssi=" + String(pClient->getRssi());
+  }
+  line += " cmd=" + String(cmd) + " n=" + String(count) + " conc=" + String(concurrency) + " payload=" + String(payloadLen) +
+          " ok=" + String(done) + " err=" + String(errors) + " wfail=" + String(writeFails) + " timeout=" + String(timeouts) +
+          " abandoned=" + String(abandoned) + " stop=" + stopReason + " secs=" + String(secs, 3) + " cmd_s=" + String(cmdRate, 1) + " rx_Bps=" + String(byteRate, 0) +
+          " rtt_min=" + String(rttMin) + " rtt_mean=" + String(rttMean) + " rtt_p50=" + String(rttP50) + " rtt_p99=" + String(rttP99);
+  Serial.println(line);
+
+  free(rtt);
+  free(payload);
+}
+
+void benchCommand(String args) {
+  int values[4] = {100, 1, 0, CMD_GET_VERSION};
+  args.trim();
+  for (int i = 0; i < 4 && args.length() > 0; i++) {
+    int sp = args.indexOf(' ');
+    String tok = sp < 0 ? args : args.substring(0, sp);
+    values[i] = tok.toInt();
+    args = sp < 0 ? "" : args.substring(sp + 1);
+    args.trim();
+  }
+  runBench(values[0], values[1], values[2], (uint16_t)values[3]);
+}
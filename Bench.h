@@ -0,0 +1,26 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "BleComm.h"
+
+#define BENCH_MAX_COUNT        1000
+#define BENCH_MAX_CONCURRENCY  8      // Simulator queue depth
+#define BENCH_MAX_PAYLOAD      256
+#define BENCH_TIMEOUT_MS       1000   // Per command
+#define BENCH_MAX_RUN_MS       120000 // Whole run, loop() is blocked meanwhile
+
+// Sustained load over the active transport: 'count' commands, up to
+// 'concurrency' in flight, each carrying 'payloadLen' filler bytes.
+// Any serial input stops the run early.
+// Prints a summary and one machine-readable "BENCH ..." line.
+void runBench(int count, int concurrency = 1, int payloadLen = 0, uint16_t cmd = CMD_GET_VERSION);
+
+// 'bench [n] [concurrency] [payload] [cmd]'
+void benchCommand(String args);
+
+#endif
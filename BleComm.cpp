@@ -4,6 +4,10 @@
  */
  
 #include "BleComm.h"
+#include "BlePairing.h"
+#include "Trace.h"
+#include "Codec.h"
+#include "DeviceShadow.h"
 
 // Define Globals for Comm
 NimBLERemoteCharacteristic* pRemoteCharacteristicRX = nullptr;
@@ -21,19 +25,53 @@ NimBLEUUID charUUID_TX("6E400003-B5A3-F393-E0A9-E50E24DCCA9E");
 uint8_t rxBuffer[512];
 uint16_t rxIndex = 0;
 
+void (*onFrameDecoded)(uint16_t cmd, uint16_t status, uint16_t payloadLen) = nullptr;
+bool commQuiet = false;
+
+// --- BLE TRANSPORT ---
+class BleTransport : public ChameleonTransport {
+public:
+  const char* name() override { return "BLE"; }
+
+  bool isReady() override {
+    if (currentState == ST_READY) return pRemoteCharacteristicRX != nullptr;
+    return pClient && pClient->isConnected() && pRemoteCharacteristicRX;
+  }
+
+  bool write(const uint8_t* data, size_t len, bool response) override {
+    return pRemoteCharacteristicRX->writeValue(data, len, response);
+  }
+};
+
+static BleTransport bleTransport;
+ChameleonTransport* activeTransport = &bleTransport;
+
+void setTransport(ChameleonTransport* t) {
+  activeTransport = t ? t : &bleTransport;
+  rxIndex = 0;
+  shadowReset("transport changed");
+  logOutput("Transport: " + String(activeTransport->name()));
+}
+
 // Helper to format hex strings efficiently
 String formatHex(const uint8_t* data, size_t len) {
-    String s = "";
-    s.reserve(len * 3); // Pre-allocate memory
-    for (size_t i = 0; i < len; i++) {
-        if (data[i] < 0x10) s += "0";
-        s += String(data[i], HEX);
-        if (i < len - 1) s += " ";
-    }
+    char small[64 * 3];
+    char* buf = (len <= 64) ? small : (char*)malloc(len * 3);
+    if (!buf) return "";
+    hexEncode(buf, data, len, ' ');
+    String s(buf);
+    if (buf != small) free(buf);
     return s;
 }
 
 static void notifyCB(NimBLERemoteCharacteristic* c, uint8_t* data, size_t len, bool isNotify) {
+  // Ignore the radio while another transport is active
+  if (activeTransport != &bleTransport) return;
+  processRx(data, len);
+}
+
+void processRx(const uint8_t* data, size_t len) {
+  TRACE_SCOPE("rx.notify", len);
   // 1. Buffer Management
   if (rxIndex + len > 512) {
       logOutput("!! RX Buffer Overflow. Resetting.");
@@ -44,7 +82,8 @@ static void notifyCB(NimBLERemoteCharacteristic* c, uint8_t* data, size_t len, b
 
   // 2. Prepare Atomic Log Message
   // We build the string first to prevent Serial interleaving from other tasks
-  String logMsg = "<< [RX Raw]: " + formatHex(data, len);
+  String logMsg;
+  if (!commQuiet) logMsg = "<< [RX Raw]: " + formatHex(data, len);
 
   // 3. Parse Frame
   // [SOF] [LRC1] [CMD_H] [CMD_L] [STAT_H] [STAT_L] [LEN_H] [LEN_L] [LRC2] + [DATA] + [LRC3]
@@ -63,6 +102,7 @@ static void notifyCB(NimBLERemoteCharacteristic* c, uint8_t* data, size_t len, b
       uint16_t totalExpected = 9 + payloadLen + 1;
       
       if (rxIndex >= totalExpected) {
+           TRACE_SCOPE("rx.decode", cmd);
            // We have a full frame. Append parsed info to logMsg.
            
            // Map Status Code
@@ -71,6 +111,9 @@ static void notifyCB(NimBLERemoteCharacteristic* c, uint8_t* data, size_t len, b
            else if (status == STATUS_OK_CUSTOM) statMsg = "Success";
            else if (status == STATUS_LF_OK) statMsg = "Success";
            else if (status == STATUS_MODE_ERR) statMsg = "Mode Error (Set Reader)";
+           else if (status == STATUS_INVALID_CMD) statMsg = "Invalid command";
+           else if (status == STATUS_NOT_IMPL) statMsg = "Not implemented";
+           else if (status == STATUS_PAR_ERR) statMsg = "Parameter error";
            else if (status == STATUS_HF_ERR || status == STATUS_LF_ERR_1 || status == STATUS_LF_ERR_2 || status == STATUS_GEN_ERR) {
                statMsg = "No card detected";
            }
@@ -87,9 +130,18 @@ static void notifyCB(NimBLERemoteCharacteristic* c, uint8_t* data, size_t len, b
                    case CMD_GET_VERSION: {
                        if (payloadLen >= 2) {
                            logMsg += "\n   -> Version: " + String(payload[0]) + "." + String(payload[1]);
+                           // Simulated answers must not land in the real device's roster entry
+                           if (activeTransport == &bleTransport) {
+                               updatePairedSession(pClient->getPeerAddress(), payload[0], payload[1]);
+                           }
                        }
                        break;
                    }
+
+                   case CMD_GET_ACTIVE_SLOT: {
+                       logMsg += "\n   -> Active Slot: " + String(payload[0]);
+                       break;
+                   }
                    
                    case CMD_SCAN_14443A: {
                        // Struct: uidLen(1) + UID(...) + ATQA(2) + SAK(1)
@@ -130,30 +182,22 @@ static void notifyCB(NimBLERemoteCharacteristic* c, uint8_t* data, size_t len, b
                }
            }
            
+           shadowOnResponse(cmd, status, &rxBuffer[9], payloadLen);
+           if (onFrameDecoded) onFrameDecoded(cmd, status, payloadLen);
+
            // Clear buffer after processing
            rxIndex = 0; 
       }
   }
 
   // ATOMIC OUTPUT
-  logOutput(logMsg);
-}
-
-// Standard LRC: 2's complement of sum
-uint8_t calcLRC(const uint8_t* data, uint16_t len) {
-  uint8_t sum = 0;
-  for (uint16_t i = 0; i < len; i++) {
-    sum += data[i]; 
-  }
-  return (uint8_t)(-sum); 
+  if (!commQuiet) logOutput(logMsg);
 }
 
-void sendUltraCommand(uint16_t cmd, const uint8_t* payload, uint16_t payloadLen) {
-  if (currentState != ST_READY) {
-     if (!pClient || !pClient->isConnected() || !pRemoteCharacteristicRX) {
-       logOutput("Not ready/connected.");
-       return;
-     }
+bool sendUltraCommand(uint16_t cmd, const uint8_t* payload, uint16_t payloadLen) {
+  if (!activeTransport->isReady()) {
+     if (!commQuiet) logOutput("Not ready/connected.");
+     return false;
   }
 
   // Frame: [SOF] [LRC1] [CMD_H] [CMD_L] [STAT_H] [STAT_L] [LEN_H] [LEN_L] [LRC2] + [DATA...] [LRC3]
@@ -177,42 +221,106 @@ void sendUltraCommand(uint16_t cmd, const uint8_t* payload, uint16_t payloadLen)
   frame[7] = payloadLen & 0xFF;
 
   // LRC2: Covers bytes 2..7
-  frame[8] = calcLRC(&frame[2], 6);
+  frame[8] = lrcCalc(&frame[2], 6);
 
   if (payloadLen > 0) {
-    memcpy(&frame[9], payload, payloadLen);
-    // LRC3: Covers DATA
-    frame[totalLen - 1] = calcLRC(&frame[9], payloadLen);
+    // LRC3: Covers DATA (computed while copying)
+    frame[totalLen - 1] = lrcCopy(&frame[9], payload, payloadLen);
   } else {
     frame[totalLen - 1] = 0x00;
   }
 
-  bool res = pRemoteCharacteristicRX->writeValue(frame, totalLen, true);
+  // Record before writing: a fast transport may answer inside write()
+  shadowOnSend(cmd, payload, payloadLen);
+  TRACE_BEGIN("tx.write", cmd);
+  bool res = activeTransport->write(frame, totalLen, true);
+  TRACE_END("tx.write", cmd);
+  if (!res) shadowOnSendFailed(cmd);
   
   // ATOMIC OUTPUT FOR TX
+  if (commQuiet) { delete[] frame; return res; }
   String logMsg = ">> [TX Cmd " + String(cmd) + "]: " + formatHex(frame, totalLen);
   logMsg += res ? " (OK)" : " (Fail)";
   logOutput(logMsg, true);
 
   delete[] frame;
+  return res;
 }
 
 void setDeviceMode(uint8_t mode) {
-    logOutput("Command: Set Device Mode to " + String(mode == MODE_READER ? "READER" : "TAG"), true);
+    String name = (mode == MODE_READER) ? "READER" : "TAG";
+    if (shadow.mode == mode) {
+        shadowSaved("Already in " + name + " mode");
+        return;
+    }
+    logOutput("Command: Set Device Mode to " + name, true);
     uint8_t data[] = {mode}; 
     sendUltraCommand(CMD_CHANGE_MODE, data, 1);
 }
 
+// Scans fail with STATUS_MODE_ERR outside reader mode
+static void ensureReaderMode() {
+    if (!activeTransport->isReady()) return;
+    if (shadow.mode == MODE_READER || shadow.pendingMode == MODE_READER) return;
+    logOutput(" -> [Shadow] Inserting READER mode change before scan", true);
+    setDeviceMode(MODE_READER);
+}
+
+// User scans get one automatic retry if the cached mode was stale
+static void sendScan(uint16_t cmd) {
+    ensureReaderMode();
+    shadow.scanRetryArmed = true;
+    shadow.retryScan = 0;
+    sendUltraCommand(cmd, nullptr, 0);
+}
+
+void retryModeErrorScan() {
+    uint16_t cmd = shadow.retryScan;
+    if (cmd == 0 || !activeTransport->isReady()) return;
+    shadow.retryScan = 0;
+    logOutput(" -> [Shadow] Scan hit MODE_ERR, switching to READER and retrying once", true);
+    ensureReaderMode();
+    sendUltraCommand(cmd, nullptr, 0);
+}
+
+void getDeviceInfo() {
+    if (shadow.fwMajor != SHADOW_UNKNOWN) {
+        logOutput("   -> Version: " + String(shadow.fwMajor) + "." + String(shadow.fwMinor) + " (cached)");
+        shadowSaved("Answered version locally");
+        return;
+    }
+    sendUltraCommand(CMD_GET_VERSION, nullptr, 0);
+}
+
+// Slot is never answered from the shadow: the A/B buttons change it with no BLE traffic
+void setActiveSlot(uint8_t slot) {
+    logOutput("Command: Set Active Slot to " + String(slot));
+    uint8_t data[] = {slot};
+    sendUltraCommand(CMD_SET_ACTIVE_SLOT, data, 1);
+}
+
+void getActiveSlot() {
+    sendUltraCommand(CMD_GET_ACTIVE_SLOT, nullptr, 0);
+}
+
 // --- NEW: PIN Implementation ---
 void setChameleonPIN(uint32_t pin) {
     char pinStr[7];
     // Format as 6-byte ASCII with leading zeros (e.g., "123456")
     snprintf(pinStr, sizeof(pinStr), "%06u", pin);
+    if (shadow.keyValid && memcmp(shadow.pairingKey, pinStr, 6) == 0) {
+        shadowSaved("PIN already set on device");
+        return;
+    }
     logOutput("Command: Setting PIN on Device to " + String(pinStr));
     sendUltraCommand(CMD_BLE_SET_PAIRING_KEY, (uint8_t*)pinStr, 6);
 }
 
 void enableChameleonPairing(bool enable) {
+    if (shadow.pairingEnabled == (enable ? 1 : 0)) {
+        shadowSaved("Pairing already " + String(enable ? "enabled" : "disabled"));
+        return;
+    }
     logOutput("Command: " + String(enable ? "Enabling" : "Disabling") + " PIN Pairing on Device");
     uint8_t data[] = { (uint8_t)(enable ? 0x01 : 0x00) };
     sendUltraCommand(CMD_BLE_SET_PAIRING_ENABLE, data, 1);
@@ -231,17 +339,17 @@ void saveSettings() {
 void sendText(const String& s) {
   if (s.indexOf("hf search") >= 0) {
     logOutput("Mapping 'hf search' to Binary CMD_SCAN_14443A...", true);
-    sendUltraCommand(CMD_SCAN_14443A, nullptr, 0);
+    sendScan(CMD_SCAN_14443A);
     return;
   }
   if (s.indexOf("lf search") >= 0) {
     logOutput("Mapping 'lf search' to Binary CMD_SCAN_125K...", true);
-    sendUltraCommand(CMD_SCAN_125K, nullptr, 0);
+    sendScan(CMD_SCAN_125K);
     return;
   }
   if (s.indexOf("info") >= 0) {
     logOutput("Mapping 'info' to Binary CMD_GET_VERSION...", true);
-    sendUltraCommand(CMD_GET_VERSION, nullptr, 0);
+    getDeviceInfo();
     return;
   }
   if (s.indexOf("mode reader") >= 0) {
@@ -253,11 +361,11 @@ void sendText(const String& s) {
     return;
   }
 
-  if (currentState != ST_READY || !pClient || !pClient->isConnected() || !pRemoteCharacteristicRX) {
+  if (!activeTransport->isReady()) {
     logOutput("Not ready/connected.");
     return;
   }
-  pRemoteCharacteristicRX->writeValue((uint8_t*)s.c_str(), s.length(), false);
+  activeTransport->write((const uint8_t*)s.c_str(), s.length(), false);
   logOutput(">> sent text (raw)");
 }
 
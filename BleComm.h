@@ -18,6 +18,8 @@ extern NimBLERemoteCharacteristic* pRemoteCharacteristicTX;
 // Commands
 #define CMD_GET_VERSION     1000
 #define CMD_CHANGE_MODE     1001
+#define CMD_SET_ACTIVE_SLOT 1003
+#define CMD_GET_ACTIVE_SLOT 1018
 #define CMD_SCAN_14443A     2000
 #define CMD_SCAN_125K       3000
 
@@ -36,21 +38,49 @@ extern NimBLERemoteCharacteristic* pRemoteCharacteristicTX;
 #define STATUS_LF_OK        0x0040 
 #define STATUS_LF_ERR_1     0x0041 
 #define STATUS_LF_ERR_2     0x0042 
+#define STATUS_PAR_ERR      0x0060
 #define STATUS_HF_ERR       0x0065 
 #define STATUS_MODE_ERR     0x0066 
+#define STATUS_INVALID_CMD  0x0067
 #define STATUS_OK_CUSTOM    0x0068 
+#define STATUS_NOT_IMPL     0x0069
 
 // Device Modes
 #define MODE_TAG    0x00
 #define MODE_READER 0x01
 
+// Transport (where command frames go, BLE by default)
+class ChameleonTransport {
+public:
+  virtual ~ChameleonTransport() {}
+  virtual const char* name() = 0;
+  virtual bool isReady() = 0;
+  virtual bool write(const uint8_t* data, size_t len, bool response) = 0;
+  virtual void poll() {}  // Called from loop()
+};
+
+extern ChameleonTransport* activeTransport;
+void setTransport(ChameleonTransport* t); // nullptr = BLE
+
+// Inbound bytes from the transport (BLE notify or simulator)
+void processRx(const uint8_t* data, size_t len);
+
+// Called for every complete response frame (benchmarks)
+extern void (*onFrameDecoded)(uint16_t cmd, uint16_t status, uint16_t payloadLen);
+// Suppress per-frame TX/RX logs
+extern bool commQuiet;
+
 // Functions
 void sendText(const String& s);
 bool setupService(); 
 bool enableNotifications(bool& subOk);
 bool triggerSecurityViaRead();
-void sendUltraCommand(uint16_t cmd, const uint8_t* payload = nullptr, uint16_t payloadLen = 0);
+bool sendUltraCommand(uint16_t cmd, const uint8_t* payload = nullptr, uint16_t payloadLen = 0);
 void setDeviceMode(uint8_t mode);
+void getDeviceInfo();
+void setActiveSlot(uint8_t slot);
+void getActiveSlot();
+void retryModeErrorScan();  // Called from loop()
 
 // PIN HELPERS
 void setChameleonPIN(uint32_t pin);
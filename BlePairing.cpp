@@ -4,12 +4,25 @@
  */
 
 #include "BlePairing.h"
+#include "Trace.h"
+#include "DeviceShadow.h"
 
 Preferences preferences;
-NimBLEAddress storedAddress; 
-bool hasStoredAddress = false;
+static RosterRecord roster;  // MRU first
 static String targetNameCache = ""; 
 
+// Roster write-back state
+#define ROSTER_HEADER_SIZE offsetof(RosterRecord, entries)
+// Guards 'roster' and the dirty flags (loop() and NimBLE host task)
+static portMUX_TYPE rosterMux = portMUX_INITIALIZER_UNLOCKED;
+static bool rosterDirty = false;
+static unsigned long rosterDirtySince = 0;
+static bool legacyKeysPending = false;
+
+// Re-scan: best known device seen so far (lower rank = more recently used)
+static NimBLEAdvertisedDevice* rescanCandidate = nullptr;
+static int rescanCandidateRank = 0;
+
 // --- PIN GLOBALS ---
 uint32_t userBLEPin = 123456;
 bool pinPairingEnabled = false;
@@ -26,7 +39,37 @@ static void scanCompleteCB(NimBLEScanResults results) {
     logOutput(String(line));
   }
   logOutput("--- Scan Complete ---");
-  currentState = ST_IDLE;
+  setState(ST_IDLE);
+}
+
+static NimBLEAddress entryAddress(const RosterEntry& e) {
+  return NimBLEAddress(e.addr, e.addrType);
+}
+
+static int rosterFind(const NimBLEAddress& addr);
+
+// Known devices use their own PIN mode, unknown ones the global setting
+static void applyDevicePinMode(const NimBLEAddress& addr) {
+  portENTER_CRITICAL(&rosterMux);
+  int idx = rosterFind(addr);
+  bool devicePin = (idx >= 0 ? roster.entries[idx].pinMode : roster.pinMode) != 0;
+  portEXIT_CRITICAL(&rosterMux);
+  if (devicePin != pinPairingEnabled) {
+    pinPairingEnabled = devicePin;
+    updateSecuritySettings();
+  }
+}
+
+static void acquireTarget(const NimBLEAdvertisedDevice* dev) {
+  if (targetDevice) delete targetDevice;
+  targetDevice = new NimBLEAdvertisedDevice(*dev);
+  applyDevicePinMode(dev->getAddress());
+  setState(ST_CONNECT_ATTEMPT);
+  stateTimer = millis();
+}
+
+static void clearRescanCandidate() {
+  if (rescanCandidate) { delete rescanCandidate; rescanCandidate = nullptr; }
 }
 
 class MyScanCallbacks : public NimBLEScanCallbacks {
@@ -52,68 +95,94 @@ class MyScanCallbacks : public NimBLEScanCallbacks {
 
       //logOutput(prefix + String(index) + ": " + name + " (" + addrStr + ") " + String(rssi) + "dBm" + saved);
     } else if (currentState == ST_RESCAN_TARGET) {
-      bool match = false;
-      if (hasStoredAddress && advertisedDevice->getAddress() == storedAddress) match = true;
-      else if (targetNameCache.length() > 0 && name.indexOf(targetNameCache) >= 0) match = true;
-      else if (advertisedDevice->haveServiceUUID() && advertisedDevice->isAdvertisingService(serviceUUID)) match = true;
-
-      if (match) {
-        logOutput(" *** TARGET RE-ACQUIRED: " + addrStr + " (RSSI: " + String(rssi) + ") ***", true);
-        
-        if (!connectable) {
-           logOutput("     WARNING: Target says NOT CONNECTABLE. Ignoring.");
-           return; 
-        }
-
-        if (targetDevice) delete targetDevice;
-        targetDevice = new NimBLEAdvertisedDevice(*advertisedDevice);
-        
+      // Known devices rank by roster position (0 = MRU), others after them
+      int rank = findPairedDevice(advertisedDevice->getAddress());
+      if (rank < 0) {
+        bool match = false;
+        if (targetNameCache.length() > 0 && name.indexOf(targetNameCache) >= 0) match = true;
+        else if (advertisedDevice->haveServiceUUID() && advertisedDevice->isAdvertisingService(serviceUUID)) match = true;
+        if (!match) return;
+        rank = ROSTER_MAX_DEVICES;
+      }
+      if (rescanCandidate && rank >= rescanCandidateRank) return;
+
+      logOutput(" *** TARGET RE-ACQUIRED: " + addrStr + " (RSSI: " + String(rssi) + ") ***", true);
+      
+      if (!connectable) {
+         logOutput("     WARNING: Target says NOT CONNECTABLE. Ignoring.");
+         return; 
+      }
+
+      // MRU device (or nothing saved): connect now. Otherwise hold it until scan end.
+      if (rank == 0 || pairedDeviceCount() == 0) {
+        clearRescanCandidate();
         NimBLEDevice::getScan()->stop();
-        currentState = ST_CONNECT_ATTEMPT;
-        stateTimer = millis(); 
+        acquireTarget(advertisedDevice);
+      } else {
+        clearRescanCandidate();
+        rescanCandidate = new NimBLEAdvertisedDevice(*advertisedDevice);
+        rescanCandidateRank = rank;
       }
     }
   }
+
+  void onScanEnd(const NimBLEScanResults& results, int reason) override {
+    if (currentState != ST_RESCAN_TARGET) return;
+    if (rescanCandidate) {
+      logOutput(" -> Best known target: " + String(rescanCandidate->getAddress().toString().c_str()), true);
+      acquireTarget(rescanCandidate);
+      clearRescanCandidate();
+    } else {
+      logOutput(" -> Target not found.", true);
+      setState(ST_CONNECT_COOLDOWN);
+      stateTimer = millis();
+    }
+  }
 };
 
 class MyClientCallback : public NimBLEClientCallbacks {
   void onConnect(NimBLEClient* pclient) override {
+    TRACE_SCOPE("cb.onConnect", 0);
     logOutput(" -> [CB] Connected.", true);
   }
 
   void onDisconnect(NimBLEClient* pclient, int reason) override {
+    TRACE_SCOPE("cb.onDisconnect", reason);
     logOutput(" -> [CB] Disconnected. Reason: " + String(reason));
     authInProgress = false;
+    shadowReset("disconnected");
     
     if (currentState >= ST_CONNECTED_PENDING) {
-        currentState = ST_CONNECT_COOLDOWN; 
+        setState(ST_CONNECT_COOLDOWN); 
         stateTimer = millis();
         retryCount = 0; 
     } else {
-        currentState = ST_IDLE;
+        setState(ST_IDLE);
     }
   }
 
   void onPassKeyEntry(NimBLEConnInfo& connInfo) override {
+    TRACE_SCOPE("cb.onPassKeyEntry", 0);
     logOutput(" -> [SEC] PIN Requested. Injecting PIN: " + String(userBLEPin), true);
     NimBLEDevice::injectPassKey(connInfo, userBLEPin);
   }
 
   void onConfirmPasskey(NimBLEConnInfo& connInfo, uint32_t pass_key) override {
+    TRACE_SCOPE("cb.onConfirmPasskey", 0);
     logOutput(" -> [SEC] Confirm Passkey: " + String(pass_key), true);
     NimBLEDevice::injectConfirmPasskey(connInfo, true);
   }
 
   void onAuthenticationComplete(NimBLEConnInfo& connInfo) override {
+    TRACE_SCOPE("cb.onAuthComplete", connInfo.isEncrypted());
     authInProgress = false; 
     lastSecurityTime = millis();
     if (connInfo.isEncrypted()) {
       logOutput(" -> [SEC] Encrypted/Bonded!");
     } else {
       logOutput(" -> [SEC] Auth Failed.");
-      logOutput(" -> Clearing local bonds to recover...");
-      NimBLEDevice::deleteAllBonds();
-      clearPairedDevice();
+      logOutput(" -> Clearing local bond to recover...");
+      if (!forgetPairedDevice(connInfo.getAddress())) NimBLEDevice::deleteBond(connInfo.getAddress());
       pClient->disconnect();
     }
   }
@@ -122,42 +191,265 @@ class MyClientCallback : public NimBLEClientCallbacks {
 static MyScanCallbacks scanCallbacks;
 static MyClientCallback clientCallbacks;
 
-void savePairedDevice(const NimBLEAddress& addr) {
-  if (!hasStoredAddress || storedAddress != addr) {
-    storedAddress = addr;
-    hasStoredAddress = true;
-    
-    preferences.begin("chameleon", false);
-    preferences.putString("bonded_addr", String(addr.toString().c_str()));
-    preferences.putUChar("bonded_type", addr.getType());
-    preferences.end();
-    
-    logOutput(" -> [NVS] Paired device saved: " + String(addr.toString().c_str()));
+// --- BOND ROSTER ---
+// Helpers named roster*/mark* expect rosterMux held (or boot, before BLE starts)
+static void markRosterDirty() {
+  if (!rosterDirty) {
+    rosterDirty = true;
+    rosterDirtySince = millis();
   }
 }
 
-void clearPairedDevice() {
-  if (hasStoredAddress) {
-    hasStoredAddress = false;
-    storedAddress = NimBLEAddress();
-    
-    preferences.begin("chameleon", false);
+static void resetRoster() {
+  memset(&roster, 0, sizeof(roster));
+  roster.version = ROSTER_VERSION;
+  roster.pin = 123456;
+}
+
+// Must be called with 'preferences' open
+static void loadRoster() {
+  resetRoster();
+
+  size_t len = preferences.getBytesLength("roster");
+  if (len >= ROSTER_HEADER_SIZE && len <= sizeof(roster)) {
+    RosterRecord rec;
+    preferences.getBytes("roster", &rec, len);
+    if (rec.version == ROSTER_VERSION && rec.count <= ROSTER_SLOTS &&
+        len == ROSTER_HEADER_SIZE + rec.count * sizeof(RosterEntry)) {
+      memcpy(&roster, &rec, len);
+      if (roster.count > ROSTER_MAX_DEVICES) {
+        // Bond limit lowered since the record was written, keep the MRU ones
+        logOutput("Boot: Roster trimmed to " + String(ROSTER_MAX_DEVICES) + " devices (NimBLE bond limit).");
+        roster.count = ROSTER_MAX_DEVICES;
+        markRosterDirty();
+      }
+      return;
+    }
+    logOutput("Boot: Roster record invalid (v" + String(rec.version) + "). Discarding.");
+  }
+
+  // Migrate legacy single-device keys
+  String savedStr = preferences.getString("bonded_addr", "");
+  if (savedStr.length() > 0) {
+    NimBLEAddress addr(savedStr.c_str(), preferences.getUChar("bonded_type", 1));
+    RosterEntry& e = roster.entries[0];
+    memcpy(e.addr, addr.getVal(), sizeof(e.addr));
+    e.addrType = addr.getType();
+    e.pinMode = preferences.getBool("pin_mode", false);
+    e.lastSeen = roster.seq = 1;
+    e.fwMajor = e.fwMinor = ROSTER_FW_UNKNOWN;
+    roster.count = 1;
+  }
+  roster.pin = preferences.getUInt("ble_pin", 123456);
+  roster.pinMode = preferences.getBool("pin_mode", false);
+
+  if (preferences.isKey("bonded_addr") || preferences.isKey("ble_pin") || preferences.isKey("pin_mode")) {
+    legacyKeysPending = true;
+    markRosterDirty();
+  }
+}
+
+void flushPairedDevices(bool force) {
+  // Snapshot under the lock, write to flash outside it
+  static RosterRecord snap;
+  portENTER_CRITICAL(&rosterMux);
+  bool due = rosterDirty && (force || millis() - rosterDirtySince >= ROSTER_FLUSH_DELAY);
+  if (due) {
+    memcpy(&snap, &roster, sizeof(snap));
+    rosterDirty = false;
+  }
+  portEXIT_CRITICAL(&rosterMux);
+  if (!due) return;
+
+  size_t len = ROSTER_HEADER_SIZE + snap.count * sizeof(RosterEntry);
+  preferences.begin("chameleon", false);
+  size_t written = preferences.putBytes("roster", &snap, len);
+  if (legacyKeysPending && written == len) {
     preferences.remove("bonded_addr");
     preferences.remove("bonded_type");
-    preferences.end();
-    
-    logOutput(" -> [NVS] Paired device forgotten.");
+    preferences.remove("ble_pin");
+    preferences.remove("pin_mode");
+    legacyKeysPending = false;
+  }
+  preferences.end();
+
+  if (written == len) {
+    logOutput(" -> [NVS] Roster committed (" + String(snap.count) + " devices, " + String(len) + " bytes)", true);
+  } else {
+    // Mark dirty again, retry after the next delay
+    portENTER_CRITICAL(&rosterMux);
+    rosterDirty = true;
+    rosterDirtySince = millis();
+    portEXIT_CRITICAL(&rosterMux);
+    logOutput(" -> [NVS] Roster commit failed.");
+  }
+}
+
+static int rosterFind(const NimBLEAddress& addr) {
+  const uint8_t* val = addr.getVal();
+  for (int i = 0; i < roster.count; i++) {
+    if (memcmp(roster.entries[i].addr, val, sizeof(roster.entries[i].addr)) == 0) return i;
+  }
+  return -1;
+}
+
+static void rosterRemove(int index) {
+  memmove(&roster.entries[index], &roster.entries[index + 1], (roster.count - index - 1) * sizeof(RosterEntry));
+  roster.count--;
+  markRosterDirty();
+}
+
+int pairedDeviceCount() {
+  portENTER_CRITICAL(&rosterMux);
+  int count = roster.count;
+  portEXIT_CRITICAL(&rosterMux);
+  return count;
+}
+
+int findPairedDevice(const NimBLEAddress& addr) {
+  portENTER_CRITICAL(&rosterMux);
+  int idx = rosterFind(addr);
+  portEXIT_CRITICAL(&rosterMux);
+  return idx;
+}
+
+void savePairedDevice(const NimBLEAddress& addr) {
+  uint16_t mtu = (pClient && pClient->isConnected()) ? pClient->getMTU() : 0;
+  bool added = false;
+  bool evicted = false;
+  RosterEntry victim;
+
+  portENTER_CRITICAL(&rosterMux);
+  int idx = rosterFind(addr);
+  RosterEntry e;
+
+  if (idx >= 0) {
+    e = roster.entries[idx];
+  } else {
+    memset(&e, 0, sizeof(e));
+    memcpy(e.addr, addr.getVal(), sizeof(e.addr));
+    e.fwMajor = e.fwMinor = ROSTER_FW_UNKNOWN;
+    if (roster.count == ROSTER_MAX_DEVICES) {
+      // Evict least recently used (last entry)
+      victim = roster.entries[roster.count - 1];
+      evicted = true;
+      roster.count--;
+    }
+    idx = roster.count++;
+    added = true;
+  }
+
+  e.addrType = addr.getType();
+  e.pinMode = pinPairingEnabled;
+  e.lastSeen = ++roster.seq;
+  if (mtu) e.mtu = mtu;
+
+  // Move to front (MRU first)
+  memmove(&roster.entries[1], &roster.entries[0], idx * sizeof(RosterEntry));
+  roster.entries[0] = e;
+  markRosterDirty();
+  portEXIT_CRITICAL(&rosterMux);
+
+  if (evicted) {
+    // Keep NimBLE's bond store in step with the roster
+    NimBLEDevice::deleteBond(entryAddress(victim));
+    logOutput(" -> [NVS] Roster full. Evicting " + String(entryAddress(victim).toString().c_str()));
+  }
+  if (added) logOutput(" -> [NVS] Paired device saved: " + String(addr.toString().c_str()));
+}
+
+void forgetPairedDevice(int index) {
+  portENTER_CRITICAL(&rosterMux);
+  bool valid = index >= 0 && index < roster.count;
+  NimBLEAddress addr;
+  if (valid) {
+    addr = entryAddress(roster.entries[index]);
+    rosterRemove(index);
+  }
+  portEXIT_CRITICAL(&rosterMux);
+
+  if (!valid) {
+    logOutput("Error: Invalid roster index.");
+    return;
+  }
+  NimBLEDevice::deleteBond(addr);
+  logOutput(" -> [NVS] Paired device forgotten: " + String(addr.toString().c_str()));
+}
+
+// Lookup and removal in one critical section (NimBLE callbacks)
+bool forgetPairedDevice(const NimBLEAddress& addr) {
+  portENTER_CRITICAL(&rosterMux);
+  int idx = rosterFind(addr);
+  if (idx >= 0) rosterRemove(idx);
+  portEXIT_CRITICAL(&rosterMux);
+
+  if (idx < 0) return false;
+  NimBLEDevice::deleteBond(addr);
+  logOutput(" -> [NVS] Paired device forgotten: " + String(addr.toString().c_str()));
+  return true;
+}
+
+void clearPairedDevice() {
+  portENTER_CRITICAL(&rosterMux);
+  bool hadDevices = roster.count > 0;
+  if (hadDevices) {
+    roster.count = 0;
+    markRosterDirty();
+  }
+  portEXIT_CRITICAL(&rosterMux);
+
+  if (hadDevices) {
+    // Explicit wipe, commit now
+    flushPairedDevices(true);
+    logOutput(" -> [NVS] Paired devices forgotten.");
   } else {
     logOutput(" -> No saved device to forget.");
   }
 }
 
+void updatePairedSession(const NimBLEAddress& addr, uint8_t fwMajor, uint8_t fwMinor) {
+  portENTER_CRITICAL(&rosterMux);
+  int idx = rosterFind(addr);
+  if (idx >= 0) {
+    RosterEntry& e = roster.entries[idx];
+    if (e.fwMajor != fwMajor || e.fwMinor != fwMinor) {
+      e.fwMajor = fwMajor;
+      e.fwMinor = fwMinor;
+      markRosterDirty();
+    }
+  }
+  portEXIT_CRITICAL(&rosterMux);
+}
+
+void listPairedDevices() {
+  static RosterRecord snap;
+  portENTER_CRITICAL(&rosterMux);
+  memcpy(&snap, &roster, sizeof(snap));
+  portEXIT_CRITICAL(&rosterMux);
+
+  logOutput("\nID | Address           | PIN | FW    | MTU | Seen");
+  for (int i = 0; i < snap.count; i++) {
+    const RosterEntry& e = snap.entries[i];
+    char fw[8];
+    if (e.fwMajor == ROSTER_FW_UNKNOWN) snprintf(fw, sizeof(fw), "?");
+    else snprintf(fw, sizeof(fw), "%u.%u", e.fwMajor, e.fwMinor);
+    char line[128];
+    snprintf(line, sizeof(line), "%2d | %s | %s | %-5s | %3u | %lu",
+              i, entryAddress(e).toString().c_str(), e.pinMode ? "Yes" : "No ", fw, e.mtu, (unsigned long)e.lastSeen);
+    logOutput(String(line));
+  }
+  logOutput("--- " + String(snap.count) + "/" + String(ROSTER_MAX_DEVICES) + " devices ---");
+}
+
 // --- NEW PIN MANAGEMENT ---
 void savePinConfig(uint32_t pin, bool enable) {
-    preferences.begin("chameleon", false);
-    preferences.putUInt("ble_pin", pin);
-    preferences.putBool("pin_mode", enable);
-    preferences.end();
+    portENTER_CRITICAL(&rosterMux);
+    roster.pin = pin;
+    roster.pinMode = enable;
+    // PIN config targets the current/next device
+    if (roster.count > 0) roster.entries[0].pinMode = enable;
+    markRosterDirty();
+    portEXIT_CRITICAL(&rosterMux);
     
     userBLEPin = pin;
     pinPairingEnabled = enable;
@@ -179,24 +471,22 @@ void updateSecuritySettings() {
 }
 
 void initBLE() {
+  // Load Roster (single read, written back lazily).
+  // Read-write so the namespace is created on first boot.
   preferences.begin("chameleon", false);
-  
-  // Load Address
-  String savedStr = preferences.getString("bonded_addr", "");
-  if (savedStr.length() > 0) {
-    uint8_t savedType = preferences.getUChar("bonded_type", 1); 
-    storedAddress = NimBLEAddress(savedStr.c_str(), savedType);
-    hasStoredAddress = true;
-    logOutput("Boot: Found saved paired device [" + savedStr + "]", true);
+  loadRoster();
+  preferences.end();
+
+  // NimBLE not started yet, no lock needed
+  if (roster.count > 0) {
+    logOutput("Boot: Found " + String(roster.count) + " saved device(s), MRU [" + String(entryAddress(roster.entries[0]).toString().c_str()) + "]", true);
   } else {
     logOutput("Boot: No saved paired device found.", true);
   }
   
   // Load PIN Settings
-  userBLEPin = preferences.getUInt("ble_pin", 123456);
-  pinPairingEnabled = preferences.getBool("pin_mode", false);
-  
-  preferences.end();
+  userBLEPin = roster.pin;
+  pinPairingEnabled = roster.pinMode;
 
   NimBLEDevice::init("ESP32_Chameleon");
   NimBLEDevice::setPower(ESP_PWR_LVL_P9); 
@@ -223,9 +513,10 @@ void triggerReScan() {
   scan->setActiveScan(false); 
   scan->setInterval(80); 
   scan->setWindow(40);   
+  clearRescanCandidate();
   
-  currentState = ST_RESCAN_TARGET;
-  scan->start(5000, scanCompleteCB, false);
+  setState(ST_RESCAN_TARGET);
+  scan->start(5000, false);
 }
 
 void startScan() {
@@ -241,7 +532,7 @@ void startScan() {
   scan->setInterval(100);
   scan->setWindow(100);
 
-  currentState = ST_SCANNING;
+  setState(ST_SCANNING);
   scan->start(10000, false);
 
   while (scan->isScanning()) {
@@ -253,14 +544,14 @@ void startScan() {
 }
 
 void startPair() {
-  if (!targetDevice && !hasStoredAddress) { 
+  if (!targetDevice && pairedDeviceCount() == 0) { 
     logOutput("Error: Run 'discover' first or no saved device."); 
     return; 
   }
   logOutput("--- Starting Pair/Connect Sequence ---");
   retryCount = 0;
   triggerReScan();
-  currentState = ST_RESCAN_TARGET;
+  setState(ST_RESCAN_TARGET);
 }
 
 void connectToScannedDevice(int index) {
@@ -275,12 +566,13 @@ void connectToScannedDevice(int index) {
     
     if (targetDevice) delete targetDevice;
     targetDevice = new NimBLEAdvertisedDevice(*dev);
+    applyDevicePinMode(dev->getAddress());
     
     // Stop any ongoing scan
     NimBLEDevice::getScan()->stop();
     
     logOutput("--- Initiating Direct Connection ---");
     retryCount = 0;
-    currentState = ST_CONNECT_ATTEMPT;
+    setState(ST_CONNECT_ATTEMPT);
     stateTimer = millis();
 }
\ No newline at end of file
@@ -8,8 +8,42 @@
 
 #include "Shared.h"
 
-extern NimBLEAddress storedAddress; 
-extern bool hasStoredAddress;
+// --- BOND ROSTER ---
+#define ROSTER_VERSION       1
+#define ROSTER_SLOTS         8      // Entries in the stored record (layout v1)
+
+// Every roster entry needs a NimBLE bond: never remember more devices than
+// NimBLE can keep bonds for (CONFIG_BT_NIMBLE_MAX_BONDS, 3 by default).
+// Raise CONFIG_BT_NIMBLE_MAX_BONDS in nimconfig.h for up to ROSTER_SLOTS.
+#if defined(CONFIG_BT_NIMBLE_MAX_BONDS) && CONFIG_BT_NIMBLE_MAX_BONDS < ROSTER_SLOTS
+#define ROSTER_MAX_DEVICES   CONFIG_BT_NIMBLE_MAX_BONDS
+#else
+#define ROSTER_MAX_DEVICES   ROSTER_SLOTS
+#endif
+#define ROSTER_FLUSH_DELAY   5000   // ms to coalesce changes into one NVS commit
+#define ROSTER_FW_UNKNOWN    0xFF
+
+// One known Chameleon (16 bytes)
+struct RosterEntry {
+  uint8_t  addr[6];
+  uint8_t  addrType;
+  uint8_t  pinMode;     // 1 = PIN pairing, 0 = Just Works
+  uint32_t lastSeen;    // Roster sequence number of last connect (no RTC on board)
+  uint8_t  fwMajor;     // Cached session info, ROSTER_FW_UNKNOWN until 'info'
+  uint8_t  fwMinor;
+  uint16_t mtu;
+} __attribute__((packed));
+
+// Stored as a single NVS blob: header + 'count' entries, MRU first
+struct RosterRecord {
+  uint8_t  version;
+  uint8_t  count;
+  uint8_t  pinMode;     // Global PIN config
+  uint8_t  reserved;
+  uint32_t pin;
+  uint32_t seq;         // Last issued lastSeen value
+  RosterEntry entries[ROSTER_SLOTS];
+} __attribute__((packed));
 
 void initBLE();
 void startScan();
@@ -21,4 +55,13 @@ void connectToScannedDevice(int index);
 void savePinConfig(uint32_t pin, bool enable);
 void updateSecuritySettings(); 
 
+// ROSTER HELPERS (the roster is shared with NimBLE callbacks, all of these lock)
+int pairedDeviceCount();
+int findPairedDevice(const NimBLEAddress& addr);
+void forgetPairedDevice(int index);
+bool forgetPairedDevice(const NimBLEAddress& addr);  // false if not in the roster
+void listPairedDevices();
+void updatePairedSession(const NimBLEAddress& addr, uint8_t fwMajor, uint8_t fwMinor);
+void flushPairedDevices(bool force = false);
+
 #endif
\ No newline at end of file
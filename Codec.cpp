@@ -0,0 +1,267 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#include "Codec.h"
+#include <string.h>
+
+// Byte -> two lowercase digits
+static const char hexPairs[513] =
+  "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+  "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+  "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+  "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+  "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+  "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+  "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+  "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+// ASCII -> nibble, 0xFF = not a hex digit
+static uint8_t hexNibble[256];
+static bool hexNibbleReady = false;
+
+static void initHexNibble() {
+  memset(hexNibble, 0xFF, sizeof(hexNibble));
+  for (int i = 0; i < 10; i++) hexNibble['0' + i] = i;
+  for (int i = 0; i < 6; i++) {
+    hexNibble['a' + i] = 10 + i;
+    hexNibble['A' + i] = 10 + i;
+  }
+  hexNibbleReady = true;
+}
+
+// Unaligned-safe 32-bit access (both ESP32 and hosts are little endian)
+static inline uint32_t load32(const void* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline void store32(void* p, uint32_t v) {
+  memcpy(p, &v, 4);
+}
+
+// 4 nibbles (one per byte lane) -> 4 lowercase ASCII digits
+static inline uint32_t nibblesToAscii(uint32_t n) {
+  // n + 6 carries into bit 4 exactly when the nibble is >= 10
+  uint32_t alpha = ((n + 0x06060606u) >> 4) & 0x01010101u;
+  return n + 0x30303030u + alpha * ('a' - '0' - 10);
+}
+
+// Bytes b0 b1 (low 16 bits) -> digits hi0 lo0 hi1 lo1
+static inline uint32_t encode16(uint32_t x) {
+  uint32_t s = (x & 0x00FFu) | ((x & 0xFF00u) << 8);
+  uint32_t n = ((s >> 4) & 0x000F000Fu) | ((s & 0x000F000Fu) << 8);
+  return nibblesToAscii(n);
+}
+
+size_t hexEncode(char* out, const uint8_t* data, size_t len, char sep) {
+  size_t i = 0;
+  char* p = out;
+
+  if (sep == 0) {
+    // SWAR: 4 bytes -> 8 digits per iteration
+    for (; i + 4 <= len; i += 4) {
+      uint32_t w = load32(&data[i]);
+      store32(p, encode16(w & 0xFFFFu));
+      store32(p + 4, encode16(w >> 16));
+      p += 8;
+    }
+    for (; i < len; i++) {
+      memcpy(p, &hexPairs[data[i] * 2], 2);
+      p += 2;
+    }
+  } else {
+    for (; i < len; i++) {
+      memcpy(p, &hexPairs[data[i] * 2], 2);
+      p[2] = sep;
+      p += 3;
+    }
+    if (len > 0) p--; // No trailing separator
+  }
+
+  *p = '\0';
+  return p - out;
+}
+
+// 0x80 in each byte lane where lo <= b <= hi (lanes must be < 0x80)
+static inline uint32_t inRange(uint32_t x, uint8_t lo, uint8_t hi) {
+  uint32_t ge = x + 0x01010101u * (0x80 - lo);
+  uint32_t gt = x + 0x01010101u * (0x7F - hi);
+  return ge & ~gt & 0x80808080u;
+}
+
+// 4 ASCII digits -> 2 bytes, false if any lane is not a hex digit
+static inline bool decode32(uint32_t v, uint8_t* out) {
+  if (v & 0x80808080u) return false;
+  uint32_t lower = v | 0x20202020u; // 'A'-'F' -> 'a'-'f', digits unchanged
+  uint32_t valid = inRange(v, '0', '9') | inRange(lower, 'a', 'f');
+  if (valid != 0x80808080u) return false;
+
+  uint32_t n = (lower & 0x0F0F0F0Fu) + ((lower >> 6) & 0x01010101u) * 9;
+  uint32_t t = ((n << 4) | (n >> 8)) & 0x00FF00FFu;
+  out[0] = (uint8_t)t;
+  out[1] = (uint8_t)(t >> 16);
+  return true;
+}
+
+int hexDecode(uint8_t* out, size_t outCap, const char* hex, size_t hexLen) {
+  if (!hexNibbleReady) initHexNibble();
+
+  size_t n = 0;
+  size_t i = 0;
+  while (i < hexLen) {
+    char c = hex[i];
+    if (c == ' ' || c == ':') { i++; continue; }
+
+    // SWAR fast path for runs of packed digits
+    if (i + 4 <= hexLen && n + 2 <= outCap && decode32(load32(&hex[i]), &out[n])) {
+      n += 2;
+      i += 4;
+      continue;
+    }
+
+    if (i + 1 >= hexLen || n >= outCap) return -1;
+    uint8_t hi = hexNibble[(uint8_t)hex[i]];
+    uint8_t lo = hexNibble[(uint8_t)hex[i + 1]];
+    if ((hi | lo) & 0xF0) return -1;
+    out[n++] = (hi << 4) | lo;
+    i += 2;
+  }
+  return (int)n;
+}
+
+// Per-lane mod-256 add, no carries between byte lanes
+static inline uint32_t laneAdd(uint32_t a, uint32_t b) {
+  return ((a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu)) ^ ((a ^ b) & 0x80808080u);
+}
+
+static inline uint8_t laneFold(uint32_t acc) {
+  return (uint8_t)(acc + (acc >> 8) + (acc >> 16) + (acc >> 24));
+}
+
+uint8_t lrcCalc(const uint8_t* data, size_t len) {
+  uint32_t acc = 0;
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) acc = laneAdd(acc, load32(&data[i]));
+  uint8_t sum = laneFold(acc);
+  for (; i < len; i++) sum += data[i];
+  return (uint8_t)(-sum);
+}
+
+uint8_t lrcCopy(uint8_t* dst, const uint8_t* src, size_t len) {
+  uint32_t acc = 0;
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint32_t w = load32(&src[i]);
+    store32(&dst[i], w);
+    acc = laneAdd(acc, w);
+  }
+  uint8_t sum = laneFold(acc);
+  for (; i < len; i++) {
+    dst[i] = src[i];
+    sum += src[i];
+  }
+  return (uint8_t)(-sum);
+}
+
+#ifdef ARDUINO
+
+#include "Shared.h"
+
+// --- Scalar references (original BleComm implementations) ---
+static String refFormatHex(const uint8_t* data, size_t len) {
+  String s = "";
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] < 0x10) s += "0";
+    s += String(data[i], HEX);
+    if (i < len - 1) s += " ";
+  }
+  return s;
+}
+
+static uint8_t refLRC(const uint8_t* data, size_t len) {
+  uint8_t sum = 0;
+  for (size_t i = 0; i < len; i++) sum += data[i];
+  return (uint8_t)(-sum);
+}
+
+#define CODEC_BENCH_LEN 4096
+
+static void reportRate(const char* name, size_t bytes, uint32_t cycles) {
+  char line[96];
+  snprintf(line, sizeof(line), "  %-14s %6u B  %9lu cyc  %.3f B/cyc",
+           name, (unsigned)bytes, (unsigned long)cycles, cycles ? (double)bytes / cycles : 0.0);
+  logOutput(String(line));
+}
+
+void codecBench() {
+  uint8_t* src = (uint8_t*)malloc(CODEC_BENCH_LEN);
+  uint8_t* dst = (uint8_t*)malloc(CODEC_BENCH_LEN);
+  char* hex = (char*)malloc(CODEC_BENCH_LEN * 3);
+  if (!src || !dst || !hex) {
+    logOutput("Codec: out of memory.");
+    free(src); free(dst); free(hex);
+    return;
+  }
+  for (size_t i = 0; i < CODEC_BENCH_LEN; i++) src[i] = (uint8_t)esp_random();
+
+  // 1. Cross-check every length/offset combination up to 67 bytes
+  int failures = 0;
+  for (size_t off = 0; off < 4; off++) {
+    for (size_t len = 0; len < 64; len++) {
+      const uint8_t* d = &src[off];
+      hexEncode(hex, d, len, ' ');
+      if (refFormatHex(d, len) != String(hex)) failures++;
+      hexEncode(hex, d, len, 0);
+      if (hexDecode(dst, CODEC_BENCH_LEN, hex, len * 2) != (int)len || memcmp(dst, d, len)) failures++;
+      if (lrcCalc(d, len) != refLRC(d, len)) failures++;
+      if (lrcCopy(&dst[off], d, len) != refLRC(d, len) || memcmp(&dst[off], d, len)) failures++;
+    }
+  }
+  logOutput("Codec: cross-check " + String(failures == 0 ? "PASS" : "FAIL") + " (" + String(failures) + " mismatches)");
+
+  // 2. Throughput on a multi-KB buffer
+  uint32_t t;
+  logOutput("Codec: " + String(CODEC_BENCH_LEN) + " byte buffer");
+
+  t = ESP.getCycleCount();
+  String ref = refFormatHex(src, CODEC_BENCH_LEN);
+  reportRate("ref formatHex", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+
+  t = ESP.getCycleCount();
+  hexEncode(hex, src, CODEC_BENCH_LEN, ' ');
+  reportRate("hex lut+sep", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+
+  t = ESP.getCycleCount();
+  size_t packed = hexEncode(hex, src, CODEC_BENCH_LEN, 0);
+  reportRate("hex swar", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+
+  t = ESP.getCycleCount();
+  hexDecode(dst, CODEC_BENCH_LEN, hex, packed);
+  reportRate("unhex swar", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+
+  volatile uint8_t sink;
+  t = ESP.getCycleCount();
+  sink = refLRC(src, CODEC_BENCH_LEN);
+  reportRate("ref lrc", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+
+  t = ESP.getCycleCount();
+  sink = lrcCalc(src, CODEC_BENCH_LEN);
+  reportRate("lrc swar", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+
+  t = ESP.getCycleCount();
+  memcpy(dst, src, CODEC_BENCH_LEN);
+  sink = refLRC(dst, CODEC_BENCH_LEN);
+  reportRate("memcpy+ref lrc", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+
+  t = ESP.getCycleCount();
+  sink = lrcCopy(dst, src, CODEC_BENCH_LEN);
+  reportRate("lrc copy", CODEC_BENCH_LEN, ESP.getCycleCount() - t);
+  (void)sink;
+
+  free(src); free(dst); free(hex);
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+// Kept free of Arduino headers so the kernels also build on a host
+#include <stddef.h>
+#include <stdint.h>
+
+// Output size of hexEncode() excluding the terminator
+#define HEX_ENCODED_LEN(len, sep) ((len) == 0 ? 0 : ((sep) ? (len) * 3 - 1 : (len) * 2))
+
+// Lowercase hex. sep = 0 packs digits, otherwise one separator between bytes.
+// Writes HEX_ENCODED_LEN + 1 chars (NUL terminated), returns the length.
+size_t hexEncode(char* out, const uint8_t* data, size_t len, char sep = ' ');
+
+// Accepts upper/lowercase, skips ' ' and ':' between bytes.
+// Returns bytes written, or -1 on bad digit, odd digit count or overflow.
+int hexDecode(uint8_t* out, size_t outCap, const char* hex, size_t hexLen);
+
+// Chameleon LRC (2's complement of byte sum)
+uint8_t lrcCalc(const uint8_t* data, size_t len);
+
+// memcpy + LRC of the copied bytes in one pass (frame building)
+uint8_t lrcCopy(uint8_t* dst, const uint8_t* src, size_t len);
+
+#ifdef ARDUINO
+// 'codec bench': cross-check against scalar reference, report bytes/cycle
+void codecBench();
+#endif
+
+#endif
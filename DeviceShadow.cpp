@@ -0,0 +1,136 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#include "DeviceShadow.h"
+#include "BleComm.h"
+
+DeviceShadow shadow = {
+  SHADOW_UNKNOWN, SHADOW_UNKNOWN, SHADOW_UNKNOWN, SHADOW_UNKNOWN, false, {0}, SHADOW_UNKNOWN,
+  SHADOW_UNKNOWN, SHADOW_UNKNOWN, SHADOW_UNKNOWN, false, {0},
+  0, false,
+  0
+};
+
+void shadowReset(const char* reason) {
+  uint32_t saved = shadow.savedRoundTrips;
+  memset(&shadow, 0, sizeof(shadow));
+  shadow.mode = shadow.fwMajor = shadow.fwMinor = SHADOW_UNKNOWN;
+  shadow.pairingEnabled = shadow.activeSlot = SHADOW_UNKNOWN;
+  shadow.pendingMode = shadow.pendingPairing = shadow.pendingSlot = SHADOW_UNKNOWN;
+  shadow.savedRoundTrips = saved;
+  logOutput(" -> [Shadow] Cleared (" + String(reason) + ")", true);
+}
+
+void shadowOnSend(uint16_t cmd, const uint8_t* payload, uint16_t len) {
+  switch (cmd) {
+    case CMD_CHANGE_MODE:
+      if (len == 1) shadow.pendingMode = payload[0];
+      break;
+    case CMD_BLE_SET_PAIRING_ENABLE:
+      if (len == 1) shadow.pendingPairing = payload[0];
+      break;
+    case CMD_BLE_SET_PAIRING_KEY:
+      if (len == 6) {
+        memcpy(shadow.pendingKey, payload, 6);
+        shadow.pendingKeyValid = true;
+      }
+      break;
+    case CMD_SET_ACTIVE_SLOT:
+      if (len == 1) shadow.pendingSlot = payload[0];
+      break;
+  }
+}
+
+// Write never reached the device, no response will settle the pending value
+void shadowOnSendFailed(uint16_t cmd) {
+  switch (cmd) {
+    case CMD_CHANGE_MODE:            shadow.pendingMode = SHADOW_UNKNOWN; break;
+    case CMD_BLE_SET_PAIRING_ENABLE: shadow.pendingPairing = SHADOW_UNKNOWN; break;
+    case CMD_BLE_SET_PAIRING_KEY:    shadow.pendingKeyValid = false; break;
+    case CMD_SET_ACTIVE_SLOT:        shadow.pendingSlot = SHADOW_UNKNOWN; break;
+  }
+}
+
+void shadowOnResponse(uint16_t cmd, uint16_t status, const uint8_t* payload, uint16_t len) {
+  bool ok = (status == STATUS_SUCCESS || status == STATUS_OK_CUSTOM || status == STATUS_LF_OK);
+
+  switch (cmd) {
+    case CMD_GET_VERSION:
+      if (ok && len >= 2) { shadow.fwMajor = payload[0]; shadow.fwMinor = payload[1]; }
+      break;
+
+    case CMD_CHANGE_MODE:
+      shadow.mode = ok ? shadow.pendingMode : SHADOW_UNKNOWN;
+      shadow.pendingMode = SHADOW_UNKNOWN;
+      break;
+
+    case CMD_SCAN_14443A:
+    case CMD_SCAN_125K:
+      // Only a result or "no tag" proves reader mode, other errors prove nothing
+      if (status == STATUS_MODE_ERR) {
+        shadow.mode = SHADOW_UNKNOWN;
+        shadow.pendingMode = SHADOW_UNKNOWN;
+        // Device changed mode locally: loop() switches to reader and retries
+        if (shadow.scanRetryArmed) shadow.retryScan = cmd;
+      } else if (ok || status == STATUS_GEN_ERR || status == STATUS_HF_ERR ||
+                 status == STATUS_LF_ERR_1 || status == STATUS_LF_ERR_2) {
+        shadow.mode = MODE_READER;
+      }
+      shadow.scanRetryArmed = false;
+      break;
+
+    case CMD_BLE_SET_PAIRING_ENABLE:
+      shadow.pairingEnabled = ok ? shadow.pendingPairing : SHADOW_UNKNOWN;
+      shadow.pendingPairing = SHADOW_UNKNOWN;
+      break;
+
+    case CMD_BLE_GET_PAIRING_ENABLE:
+      shadow.pairingEnabled = (ok && len >= 1) ? payload[0] : SHADOW_UNKNOWN;
+      break;
+
+    case CMD_BLE_SET_PAIRING_KEY:
+      shadow.keyValid = ok && shadow.pendingKeyValid;
+      if (shadow.keyValid) memcpy(shadow.pairingKey, shadow.pendingKey, 6);
+      shadow.pendingKeyValid = false;
+      break;
+
+    case CMD_BLE_GET_PAIRING_KEY:
+      shadow.keyValid = ok && len >= 6;
+      if (shadow.keyValid) memcpy(shadow.pairingKey, payload, 6);
+      break;
+
+    case CMD_SET_ACTIVE_SLOT:
+      shadow.activeSlot = ok ? shadow.pendingSlot : SHADOW_UNKNOWN;
+      shadow.pendingSlot = SHADOW_UNKNOWN;
+      break;
+
+    case CMD_GET_ACTIVE_SLOT:
+      shadow.activeSlot = (ok && len >= 1) ? payload[0] : SHADOW_UNKNOWN;
+      break;
+
+    case CMD_FACTORY_RESET:
+      shadowReset("factory reset");
+      break;
+  }
+}
+
+void shadowSaved(const String& what) {
+  shadow.savedRoundTrips++;
+  logOutput(" -> [Shadow] " + what + " (round trips saved: " + String(shadow.savedRoundTrips) + ")");
+}
+
+static String shadowValue(uint8_t v) {
+  return v == SHADOW_UNKNOWN ? String("?") : String(v);
+}
+
+void shadowPrint() {
+  String mode = shadow.mode == MODE_READER ? "READER" : (shadow.mode == MODE_TAG ? "TAG" : "?");
+  String fw = shadow.fwMajor == SHADOW_UNKNOWN ? String("?") : String(shadow.fwMajor) + "." + String(shadow.fwMinor);
+  char key[7] = "?";
+  if (shadow.keyValid) { memcpy(key, shadow.pairingKey, 6); key[6] = '\0'; }
+  logOutput("Shadow: mode=" + mode + " fw=" + fw + " pairing=" + shadowValue(shadow.pairingEnabled) +
+            " key=" + key + " slot=" + shadowValue(shadow.activeSlot) +
+            " saved=" + String(shadow.savedRoundTrips));
+}
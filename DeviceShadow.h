@@ -0,0 +1,46 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#ifndef DEVICE_SHADOW_H
+#define DEVICE_SHADOW_H
+
+#include "Shared.h"
+
+#define SHADOW_UNKNOWN 0xFF
+
+// Last known device state for the current session
+struct DeviceShadow {
+  uint8_t mode;            // MODE_TAG / MODE_READER / SHADOW_UNKNOWN
+  uint8_t fwMajor;         // SHADOW_UNKNOWN until a version response
+  uint8_t fwMinor;
+  uint8_t pairingEnabled;  // 0 / 1 / SHADOW_UNKNOWN
+  bool keyValid;
+  char pairingKey[6];
+  uint8_t activeSlot;      // 0-7 / SHADOW_UNKNOWN, display only (buttons change it)
+
+  // Sent but not yet confirmed (SHADOW_UNKNOWN = none)
+  uint8_t pendingMode;
+  uint8_t pendingPairing;
+  uint8_t pendingSlot;
+  bool pendingKeyValid;
+  char pendingKey[6];
+
+  // Scan that hit MODE_ERR, re-sent once from loop() after a mode change (0 = none)
+  uint16_t retryScan;
+  bool scanRetryArmed;       // Set by user scans, used up by their first answer
+
+  uint32_t savedRoundTrips;  // Since boot
+};
+
+extern DeviceShadow shadow;
+
+void shadowReset(const char* reason);
+void shadowOnSend(uint16_t cmd, const uint8_t* payload, uint16_t len);
+void shadowOnSendFailed(uint16_t cmd);
+void shadowOnResponse(uint16_t cmd, uint16_t status, const uint8_t* payload, uint16_t len);
+void shadowSaved(const String& what);
+void shadowPrint();
+
+#endif
@@ -6,6 +6,11 @@
 #include "Shared.h"
 #include "BlePairing.h"
 #include "BleComm.h"
+#include "Trace.h"
+#include "Codec.h"
+#include "SimChameleon.h"
+#include "Bench.h"
+#include "DeviceShadow.h"
 
 // --- DEFINE MAIN GLOBALS ---
 NimBLEClient* pClient = nullptr;
@@ -27,6 +32,20 @@ void logOutput(const String& msg, bool debug_bypass) {
   }
 }
 
+void setState(AppState state) {
+  currentState = state;
+  TRACE_STATE(state);
+}
+
+// toInt() turns anything non-numeric into 0, check digits first
+static bool isNumber(const String& s) {
+  if (s.length() == 0) return false;
+  for (unsigned int i = 0; i < s.length(); i++) {
+    if (!isDigit(s.charAt(i))) return false;
+  }
+  return true;
+}
+
 // --- MAIN LOOP & COMMANDS ---
 
 void processCommand(String cmd) {
@@ -48,6 +67,28 @@ void processCommand(String cmd) {
   } else if (cmd == "forget") {
     clearPairedDevice();
     NimBLEDevice::deleteAllBonds();
+  // BLE control - forget one saved device
+  } else if (cmd.startsWith("forget ")) {
+    String idStr = cmd.substring(7);
+    if (!isNumber(idStr)) logOutput("Error: Usage 'forget <id>', IDs are listed by 'devices'.");
+    else forgetPairedDevice((int)idStr.toInt());
+  // BLE control - list saved devices
+  } else if (cmd == "devices") {
+    listPairedDevices();
+  // Event trace export (see tools/trace2chrome.py)
+  } else if (cmd == "trace dump") {
+    traceDump();
+  } else if (cmd == "trace clear") {
+    traceClear();
+  // Hex/LRC kernel self-check and bytes/cycle
+  } else if (cmd == "codec bench") {
+    codecBench();
+  // Software Chameleon (no hardware needed)
+  } else if (cmd == "sim" || cmd.startsWith("sim ")) {
+    simCommand(cmd.substring(3));
+  // Link load test over the active transport
+  } else if (cmd == "bench" || cmd.startsWith("bench ")) {
+    benchCommand(cmd.substring(5));
   // BLE control - pin reset
   } else if (cmd == "clear bonds") { 
     clearChameleonBonds();
@@ -104,6 +145,19 @@ void processCommand(String cmd) {
   // Chameleon modes
   } else if (cmd == "mode reader") {
     sendText("mode reader");
+  } else if (cmd == "mode tag") {
+    sendText("mode tag");
+  // Chameleon slots
+  } else if (cmd == "slot") {
+    getActiveSlot();
+  } else if (cmd.startsWith("slot ")) {
+    String slotStr = cmd.substring(5);
+    int slot = slotStr.toInt();
+    if (!isNumber(slotStr) || slot < 0 || slot > 7) logOutput("Error: Slot must be 0-7.");
+    else setActiveSlot(slot);
+  // Cached device state
+  } else if (cmd == "shadow") {
+    shadowPrint();
   // Bluetooth device selection 
   } else if (cmd.length() > 0 && isDigit(cmd.charAt(0))) {
       int idx = cmd.toInt();
@@ -115,12 +169,15 @@ void processCommand(String cmd) {
     if (pClient) pClient->disconnect();
     if (targetDevice) { delete targetDevice;
     targetDevice = nullptr; }
-    currentState = ST_IDLE;
+    setState(ST_IDLE);
   // List ESP console commands (this else if)
   } else if (cmd == "help") {
     logOutput("[BLE] : discover | pair      | drop    | forget | clear bonds | pin_enable 123456");
+    logOutput("[NVS] : devices  | forget <id>");
     logOutput("[SCAN]: scan     | scan hf   | scan lf");
-    logOutput("[SYS] : info     | mode reader ");
+    logOutput("[DEV] : mode tag | slot [0-7] | shadow");
+    logOutput("[SYS] : info     | mode reader | trace dump | trace clear | codec bench");
+    logOutput("[TEST]: sim on   | sim off   | sim show | bench [n] [conc] [payload] [cmd]");
   }
 }
 
@@ -130,15 +187,20 @@ void setup() {
   while (!Serial) {}
   // Make Boot Button Execute Functions
   pinMode(0, INPUT_PULLUP);
+  // Open the first state slice in the trace
+  setState(ST_IDLE);
   // Ebable BLE
   initBLE();
   // Output help
   logOutput("Ready. Commands:");
   logOutput("[BLE] : discover | pair      | drop    | forget | clear bonds | pin_enable 123456");
+  logOutput("[NVS] : devices  | forget <id>");
   logOutput("[SCAN]: scan     | scan hf   | scan lf");
-  logOutput("[SYS] : info     | mode reader ");
+  logOutput("[DEV] : mode tag | slot [0-7] | shadow");
+  logOutput("[SYS] : info     | mode reader | trace dump | trace clear | codec bench");
+  logOutput("[TEST]: sim on   | sim off   | sim show | bench [n] [conc] [payload] [cmd]");
   // Debug mode will probe Chameleon info on connection
-  if (hasStoredAddress && DEBUG_MODE) {
+  if (pairedDeviceCount() > 0 && DEBUG_MODE) {
     logOutput("Boot: Triggering auto-connect scan...", true);
     triggerReScan();
   }
@@ -153,6 +215,12 @@ void loop() {
       processCommand("scan"); 
       delay(500); // Debounce to prevent double triggering
   }
+  // Commit pending roster changes (coalesced)
+  flushPairedDevices();
+  // Deliver simulator responses
+  activeTransport->poll();
+  // Re-send a scan the device rejected with MODE_ERR (not from the NimBLE task)
+  retryModeErrorScan();
   // BLE stack management
   switch (currentState) {
     
@@ -160,7 +228,7 @@ void loop() {
       logOutput("Step 2: Connect Attempt " + String(retryCount + 1), true);
       if (targetDevice == nullptr) {
         logOutput(" -> Error: Target device lost or not found during scan.");
-        currentState = ST_IDLE;
+        setState(ST_IDLE);
         break;
       }
       NimBLEScan* scan = NimBLEDevice::getScan();
@@ -172,7 +240,7 @@ void loop() {
       if (pClient->isConnected()) {
         logOutput("     Debug: Client reports ALREADY CONNECTED.", true);
         logOutput(" -> Connect Accepted (Pre-existing). Settling...");
-        currentState = ST_CONNECTED_PENDING;
+        setState(ST_CONNECTED_PENDING);
         stateTimer = millis();
         break;
       }
@@ -186,11 +254,11 @@ void loop() {
       }
       if (connected) {
         logOutput(" -> Connect Accepted. Settling...", true);
-        currentState = ST_CONNECTED_PENDING;
+        setState(ST_CONNECTED_PENDING);
         stateTimer = millis();
       } else {
         logOutput(" -> Connect Failed. Error: " + String(pClient->getLastError()), true);
-        currentState = ST_CONNECT_COOLDOWN;
+        setState(ST_CONNECT_COOLDOWN);
         stateTimer = millis();
       }
       break;
@@ -205,7 +273,7 @@ void loop() {
         } else {
           logOutput(" -> All Retries Failed.");
           NimBLEDevice::getScan()->clearResults();
-          currentState = ST_IDLE;
+          setState(ST_IDLE);
         }
       }
       break;
@@ -216,17 +284,17 @@ void loop() {
         if (pClient && pClient->isConnected()) {         
           if (pClient->getConnInfo().isEncrypted()) {
              logOutput(" -> Security Auto-Established (Bonded).");
-             currentState = ST_SECURITY_SETTLE; 
+             setState(ST_SECURITY_SETTLE); 
              stateTimer = millis();
           } 
           else {
              logOutput("Step 3: Moving to Discovery (Lazy Security)...", true);
-             currentState = ST_DISCOVERING;
+             setState(ST_DISCOVERING);
              stateTimer = millis();
           }
         } else {
           logOutput(" -> Link Lost while Pending.", true);
-          currentState = ST_CONNECT_COOLDOWN;
+          setState(ST_CONNECT_COOLDOWN);
           stateTimer = millis();
         }
       }
@@ -237,14 +305,14 @@ void loop() {
       if (authInProgress) {
          if (millis() - stateTimer > 20000) {
             logOutput(" -> Security Timeout (Callback missing).", true);
-            currentState = ST_READY; 
+            setState(ST_READY); 
          }
          break;
       }
       if (pClient->isConnected() && pClient->getConnInfo().isEncrypted()) {
          logOutput(" -> Encryption Verified. Saving Pairing...");
          savePairedDevice(pClient->getPeerAddress());
-         currentState = ST_READY; 
+         setState(ST_READY); 
          break; 
       }
       break;
@@ -253,14 +321,14 @@ void loop() {
     case ST_SECURITY_SETTLE: {
         if (millis() - stateTimer < 3000) return;
         logOutput(" -> Security Settled. Moving to Discovery.", true);
-        currentState = ST_DISCOVERING;
+        setState(ST_DISCOVERING);
         stateTimer = millis();
         break;
     }
 
     case ST_DISCOVERING: {
       if (!pClient || !pClient->isConnected()) {
-        currentState = ST_CONNECT_COOLDOWN;
+        setState(ST_CONNECT_COOLDOWN);
         stateTimer = millis();
         break;
       }
@@ -269,13 +337,13 @@ void loop() {
         logOutput("Step 5: Enabling Notifications...", true);
         logOutput("     Debug: Waiting 1000ms before Subscribe...", true);
         retryCount = 0; 
-        currentState = ST_SUBSCRIBING;
+        setState(ST_SUBSCRIBING);
         stateTimer = millis();
         authInProgress = false;
         lastSecurityTime = millis(); 
       } else {
         pClient->disconnect();
-        currentState = ST_CONNECT_COOLDOWN;
+        setState(ST_CONNECT_COOLDOWN);
       }
       break;
     }
@@ -293,7 +361,7 @@ void loop() {
       if (result && subOk) {
         logOutput(" -> Notifications ENABLED. Comm Link Open.", true);
         savePairedDevice(pClient->getPeerAddress());
-        currentState = ST_READY;
+        setState(ST_READY);
         stateTimer = millis();
         retryCount = 0;
         NimBLEDevice::getScan()->clearResults();
@@ -310,7 +378,7 @@ void loop() {
          if (retryCount >= MAX_RETRIES) {
            logOutput(" -> CRITICAL: Subscribe failed after max attempts. Resetting.");
            pClient->disconnect();
-           currentState = ST_CONNECT_COOLDOWN;
+           setState(ST_CONNECT_COOLDOWN);
          }
       }
       break;
@@ -319,7 +387,7 @@ void loop() {
     case ST_READY: {
       if (!pClient || !pClient->isConnected()) {
         logOutput(" -> Link dropped.",true);
-        currentState = ST_IDLE;
+        setState(ST_IDLE);
       }
       break;
     }
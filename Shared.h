@@ -9,6 +9,7 @@
 #define SHARED_H
 
 #define DEBUG_MODE false
+#define TRACE_MODE false   // Compile in event tracing (trace dump)
 
 #include <Arduino.h>
 #include <NimBLEDevice.h>
@@ -49,5 +50,7 @@ extern NimBLEUUID charUUID_RX;
 extern NimBLEUUID charUUID_TX;
 
 void logOutput(const String& msg, bool debug_bypass = false);
+// Assign currentState (and trace the transition)
+void setState(AppState state);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#include "SimChameleon.h"
+#include "Trace.h"
+#include "Codec.h"
+
+#define SIM_FW_MAJOR 2
+#define SIM_FW_MINOR 0
+#define SIM_SLOT_COUNT 8
+
+SimChameleon simChameleon;
+
+SimChameleon::SimChameleon() {
+  config.delayMs = 20;
+  config.fragSize = 20;
+  config.lossPct = 0;
+  config.forceStatus = false;
+  config.status = STATUS_SUCCESS;
+  config.hfTags = 1;
+  config.lfTags = 1;
+  qHead = 0;
+  qCount = 0;
+  reset();
+}
+
+void SimChameleon::reset() {
+  mode = MODE_TAG;  // Real devices boot in emulation mode
+  pairingEnabled = false;
+  memcpy(pairingKey, "123456", 6);
+  activeSlot = 0;
+  hfNext = lfNext = 0;
+  framesIn = framesBad = framesLost = framesOut = 0;
+  generateTags();
+}
+
+void SimChameleon::generateTags() {
+  for (int i = 0; i < SIM_MAX_TAGS; i++) {
+    for (int j = 0; j < 7; j++) hfUid[i][j] = (uint8_t)esp_random();
+    for (int j = 0; j < 5; j++) lfId[i][j] = (uint8_t)esp_random();
+  }
+}
+
+bool SimChameleon::write(const uint8_t* data, size_t len, bool response) {
+  framesIn++;
+
+  // Validate exactly as the firmware would: SOF, LRC1, LRC2, length, LRC3
+  if (len < 10 || data[0] != CHAMELEON_SOF || data[1] != lrcCalc(&data[0], 1) ||
+      data[8] != lrcCalc(&data[2], 6)) {
+    framesBad++;
+    return true;  // BLE write itself succeeds, the device drops the frame
+  }
+  uint16_t cmd = (data[2] << 8) | data[3];
+  uint16_t payloadLen = (data[6] << 8) | data[7];
+  if (len != 10u + payloadLen || data[len - 1] != lrcCalc(&data[9], payloadLen)) {
+    framesBad++;
+    return true;
+  }
+
+  uint8_t out[SIM_FRAME_MAX - 10];
+  uint16_t outLen = 0;
+  uint16_t status = handle(cmd, &data[9], payloadLen, out, outLen);
+  if (config.forceStatus) {
+    status = config.status;
+    outLen = 0;
+  }
+  respond(cmd, status, out, outLen);
+  return true;
+}
+
+uint16_t SimChameleon::handle(uint16_t cmd, const uint8_t* payload, uint16_t len, uint8_t* out, uint16_t& outLen) {
+  switch (cmd) {
+    case CMD_GET_VERSION:
+      out[0] = SIM_FW_MAJOR;
+      out[1] = SIM_FW_MINOR;
+      outLen = 2;
+      return STATUS_OK_CUSTOM;  // Device commands answer 0x68, only tag results use 0x00
+
+    case CMD_CHANGE_MODE:
+      if (len != 1 || payload[0] > MODE_READER) return STATUS_PAR_ERR;
+      mode = payload[0];
+      return STATUS_OK_CUSTOM;
+
+    case CMD_SET_ACTIVE_SLOT:
+      if (len != 1 || payload[0] >= SIM_SLOT_COUNT) return STATUS_PAR_ERR;
+      activeSlot = payload[0];
+      return STATUS_OK_CUSTOM;
+
+    case CMD_GET_ACTIVE_SLOT:
+      out[0] = activeSlot;
+      outLen = 1;
+      return STATUS_OK_CUSTOM;
+
+    case CMD_SCAN_14443A: {
+      if (mode != MODE_READER) return STATUS_MODE_ERR;
+      if (config.hfTags == 0) return STATUS_HF_ERR;
+      // Alternate 4 and 7 byte UIDs across the population
+      uint8_t idx = hfNext++ % config.hfTags;
+      uint8_t uidLen = (idx & 1) ? 7 : 4;
+      out[0] = uidLen;
+      memcpy(&out[1], hfUid[idx], uidLen);
+      out[1 + uidLen] = 0x00;
+      out[2 + uidLen] = (uidLen == 4) ? 0x04 : 0x44;
+      out[3 + uidLen] = (uidLen == 4) ? 0x08 : 0x00;
+      outLen = 4 + uidLen;
+      return STATUS_SUCCESS;
+    }
+
+    case CMD_SCAN_125K: {
+      if (mode != MODE_READER) return STATUS_MODE_ERR;
+      if (config.lfTags == 0) return STATUS_LF_ERR_1;
+      uint8_t idx = lfNext++ % config.lfTags;
+      memcpy(out, lfId[idx], 5);
+      outLen = 5;
+      return STATUS_LF_OK;
+    }
+
+    case CMD_BLE_SET_PAIRING_KEY:
+      if (len != 6) return STATUS_PAR_ERR;
+      for (int i = 0; i < 6; i++) if (!isDigit(payload[i])) return STATUS_PAR_ERR;
+      memcpy(pairingKey, payload, 6);
+      return STATUS_OK_CUSTOM;
+
+    case CMD_BLE_GET_PAIRING_KEY:
+      memcpy(out, pairingKey, 6);
+      outLen = 6;
+      return STATUS_OK_CUSTOM;
+
+    case CMD_BLE_SET_PAIRING_ENABLE:
+      if (len != 1 || payload[0] > 1) return STATUS_PAR_ERR;
+      pairingEnabled = payload[0];
+      return STATUS_OK_CUSTOM;
+
+    case CMD_BLE_GET_PAIRING_ENABLE:
+      out[0] = pairingEnabled;
+      outLen = 1;
+      return STATUS_OK_CUSTOM;
+
+    case CMD_BLE_DELETE_ALL_BONDS:
+    case CMD_SAVE_SETTINGS:
+      return STATUS_OK_CUSTOM;
+
+    case CMD_FACTORY_RESET:
+      mode = MODE_TAG;
+      activeSlot = 0;
+      pairingEnabled = false;
+      memcpy(pairingKey, "123456", 6);
+      return STATUS_OK_CUSTOM;
+
+    default:
+      return STATUS_INVALID_CMD;
+  }
+}
+
+void SimChameleon::respond(uint16_t cmd, uint16_t status, const uint8_t* payload, uint16_t len) {
+  if (config.lossPct > 0 && (esp_random() % 100) < config.lossPct) {
+    framesLost++;
+    return;
+  }
+  if (qCount == SIM_QUEUE_DEPTH) {
+    framesLost++;
+    return;
+  }
+
+  Pending& p = queue[(qHead + qCount) % SIM_QUEUE_DEPTH];
+  p.due = micros() + config.delayMs * 1000;
+  p.len = 10 + len;
+  p.data[0] = CHAMELEON_SOF;
+  p.data[1] = lrcCalc(&p.data[0], 1);
+  p.data[2] = (cmd >> 8) & 0xFF;
+  p.data[3] = cmd & 0xFF;
+  p.data[4] = (status >> 8) & 0xFF;
+  p.data[5] = status & 0xFF;
+  p.data[6] = (len >> 8) & 0xFF;
+  p.data[7] = len & 0xFF;
+  p.data[8] = lrcCalc(&p.data[2], 6);
+  p.data[9 + len] = lrcCopy(&p.data[9], payload, len);
+  qCount++;
+}
+
+void SimChameleon::poll() {
+  while (qCount > 0 && (int32_t)(micros() - queue[qHead].due) >= 0) {
+    TRACE_SCOPE("sim.deliver", queue[qHead].len);
+    Pending& p = queue[qHead];
+    // Split like BLE notifications
+    uint16_t frag = config.fragSize ? config.fragSize : p.len;
+    for (uint16_t off = 0; off < p.len; off += frag) {
+      uint16_t n = (p.len - off < frag) ? p.len - off : frag;
+      processRx(&p.data[off], n);
+    }
+    framesOut++;
+    qHead = (qHead + 1) % SIM_QUEUE_DEPTH;
+    qCount--;
+  }
+}
+
+void SimChameleon::printStatus() {
+  String status = config.forceStatus ? String(config.status, HEX) : String("auto");
+  logOutput("SIM: delay=" + String(config.delayMs) + "ms frag=" + String(config.fragSize) +
+            " loss=" + String(config.lossPct) + "% status=" + status +
+            " tags hf=" + String(config.hfTags) + " lf=" + String(config.lfTags));
+  logOutput("SIM: mode=" + String(mode == MODE_READER ? "READER" : "TAG") + " pairing=" + String(pairingEnabled) + " slot=" + String(activeSlot) +
+            " in=" + String(framesIn) + " bad=" + String(framesBad) + " lost=" + String(framesLost) + " out=" + String(framesOut));
+}
+
+void simCommand(String args) {
+  args.trim();
+  int sp = args.indexOf(' ');
+  String key = sp < 0 ? args : args.substring(0, sp);
+  String val = sp < 0 ? "" : args.substring(sp + 1);
+  val.trim();
+  SimConfig& c = simChameleon.config;
+
+  if (key == "on") {
+    setTransport(&simChameleon);
+  } else if (key == "off") {
+    setTransport(nullptr);
+  } else if (key == "reset") {
+    simChameleon.reset();
+  } else if (key == "delay" && val.length() > 0) {
+    c.delayMs = constrain(val.toInt(), 0, SIM_MAX_DELAY_MS);
+  } else if (key == "frag" && val.length() > 0) {
+    c.fragSize = constrain(val.toInt(), 0, SIM_FRAME_MAX);
+  } else if (key == "loss" && val.length() > 0) {
+    c.lossPct = constrain(val.toInt(), 0, 100);
+  } else if (key == "status" && val.length() > 0) {
+    c.forceStatus = (val != "auto");
+    c.status = strtoul(val.c_str(), nullptr, 16);
+  } else if (key == "tags" && val.length() > 0) {
+    int sp2 = val.indexOf(' ');
+    c.hfTags = constrain(val.toInt(), 0, SIM_MAX_TAGS);
+    c.lfTags = (sp2 < 0) ? c.lfTags : constrain(val.substring(sp2 + 1).toInt(), 0, SIM_MAX_TAGS);
+    simChameleon.generateTags();
+  } else if (key != "" && key != "show") {
+    logOutput("Usage: sim on | off | show | reset | delay <ms> | frag <bytes> | loss <pct> | status <hex>|auto | tags <hf> [lf]");
+    return;
+  }
+  simChameleon.printStatus();
+}
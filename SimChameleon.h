@@ -0,0 +1,79 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#ifndef SIM_CHAMELEON_H
+#define SIM_CHAMELEON_H
+
+#include "BleComm.h"
+
+#define SIM_MAX_TAGS      8
+#define SIM_QUEUE_DEPTH   8    // Responses in flight
+#define SIM_FRAME_MAX     64   // Largest response frame
+#define SIM_MAX_DELAY_MS  10000
+
+// Behaviour knobs ('sim ...' commands)
+struct SimConfig {
+  uint32_t delayMs;      // Command -> first notification
+  uint16_t fragSize;     // Notification size (MTU - 3)
+  uint8_t  lossPct;      // Chance a response is never sent
+  bool     forceStatus;  // Answer everything with 'status'
+  uint16_t status;
+  uint8_t  hfTags;       // Tags in the field
+  uint8_t  lfTags;
+};
+
+// Software Chameleon Ultra behind the transport interface
+class SimChameleon : public ChameleonTransport {
+public:
+  SimConfig config;
+
+  SimChameleon();
+  const char* name() override { return "SIM"; }
+  bool isReady() override { return true; }
+  bool write(const uint8_t* data, size_t len, bool response) override;
+  void poll() override;
+
+  void reset();
+  void generateTags();
+  void printStatus();
+
+private:
+  struct Pending {
+    uint32_t due;        // micros()
+    uint16_t len;
+    uint8_t data[SIM_FRAME_MAX];
+  };
+
+  // Device state
+  uint8_t mode;
+  bool pairingEnabled;
+  uint8_t pairingKey[6];
+  uint8_t activeSlot;
+  uint8_t hfUid[SIM_MAX_TAGS][7];
+  uint8_t lfId[SIM_MAX_TAGS][5];
+  uint8_t hfNext;
+  uint8_t lfNext;
+
+  // Response queue (ring)
+  Pending queue[SIM_QUEUE_DEPTH];
+  uint8_t qHead;
+  uint8_t qCount;
+
+  // Counters
+  uint32_t framesIn;
+  uint32_t framesBad;
+  uint32_t framesLost;
+  uint32_t framesOut;
+
+  uint16_t handle(uint16_t cmd, const uint8_t* payload, uint16_t len, uint8_t* out, uint16_t& outLen);
+  void respond(uint16_t cmd, uint16_t status, const uint8_t* payload, uint16_t len);
+};
+
+extern SimChameleon simChameleon;
+
+// 'sim ...' serial command
+void simCommand(String args);
+
+#endif
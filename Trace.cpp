@@ -0,0 +1,108 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#include "Trace.h"
+
+#if TRACE_MODE
+
+#include <esp_timer.h>
+
+struct TraceEvent {
+  uint32_t ts;          // Microseconds since boot (wraps after ~71 min)
+  const char* name;
+  uint16_t arg;
+  char phase;
+  uint8_t core;
+};
+
+static TraceEvent traceRing[TRACE_RING_SIZE];
+static uint32_t traceCount = 0;   // Total events recorded since clear
+static portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Must match AppState order in Shared.h
+static const char* const stateNames[] = {
+  "ST_IDLE", "ST_SCANNING", "ST_RESCAN_TARGET", "ST_CONNECT_ATTEMPT",
+  "ST_CONNECT_COOLDOWN", "ST_CONNECTED_PENDING", "ST_SECURING",
+  "ST_SECURITY_SETTLE", "ST_DISCOVERING", "ST_SUBSCRIBING", "ST_READY"
+};
+static int tracedState = -1;
+
+// Caller holds traceMux. Timestamp taken under the lock so ring order matches time order.
+static void traceRecord(const char* name, char phase, uint16_t arg) {
+  uint32_t ts = (uint32_t)esp_timer_get_time();
+  uint8_t core = (uint8_t)xPortGetCoreID();
+  TraceEvent& e = traceRing[traceCount % TRACE_RING_SIZE];
+  e.ts = ts;
+  e.name = name;
+  e.arg = arg;
+  e.phase = phase;
+  e.core = core;
+  traceCount++;
+}
+
+void traceEvent(const char* name, char phase, uint16_t arg) {
+  // Callbacks run on the NimBLE host task, everything else on loop()
+  portENTER_CRITICAL(&traceMux);
+  traceRecord(name, phase, arg);
+  portEXIT_CRITICAL(&traceMux);
+}
+
+// Each state is a slice; called from setState() wherever the state is assigned
+// (loop() and NimBLE callbacks), records only transitions
+void traceState(int state) {
+  int count = sizeof(stateNames) / sizeof(stateNames[0]);
+  portENTER_CRITICAL(&traceMux);
+  if (state != tracedState) {
+    if (tracedState >= 0 && tracedState < count) traceRecord(stateNames[tracedState], TRACE_PH_END, 0);
+    if (state >= 0 && state < count) traceRecord(stateNames[state], TRACE_PH_BEGIN, 0);
+    tracedState = state;
+  }
+  portEXIT_CRITICAL(&traceMux);
+}
+
+void traceDump() {
+  // Snapshot so the dump is consistent while BLE keeps tracing
+  static TraceEvent snap[TRACE_RING_SIZE];
+  portENTER_CRITICAL(&traceMux);
+  uint32_t total = traceCount;
+  memcpy(snap, traceRing, sizeof(snap));
+  portEXIT_CRITICAL(&traceMux);
+
+  uint32_t n = total < TRACE_RING_SIZE ? total : TRACE_RING_SIZE;
+  uint32_t first = total - n;
+
+  // Line format parsed by tools/trace2chrome.py
+  logOutput("TRACE BEGIN " + String(n) + " " + String(first));
+  char line[96];
+  for (uint32_t i = first; i < total; i++) {
+    const TraceEvent& e = snap[i % TRACE_RING_SIZE];
+    snprintf(line, sizeof(line), "TRACE %lu %c %u %u %s",
+             (unsigned long)e.ts, e.phase, e.core, e.arg, e.name);
+    Serial.println(line);
+  }
+  logOutput("TRACE END");
+}
+
+void traceClear() {
+  portENTER_CRITICAL(&traceMux);
+  traceCount = 0;
+  // Reopen the current state's slice, the next transition only happens on change
+  int count = sizeof(stateNames) / sizeof(stateNames[0]);
+  if (tracedState >= 0 && tracedState < count) traceRecord(stateNames[tracedState], TRACE_PH_BEGIN, 0);
+  portEXIT_CRITICAL(&traceMux);
+  logOutput("Trace cleared.");
+}
+
+#else
+
+void traceDump() {
+  logOutput("Trace: disabled at build time (set TRACE_MODE in Shared.h).");
+}
+
+void traceClear() {
+  traceDump();
+}
+
+#endif
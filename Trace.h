@@ -0,0 +1,56 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "Shared.h"
+
+// Event ring (12 bytes per event, oldest overwritten when full)
+#define TRACE_RING_SIZE 512
+
+// Event phases (Chrome trace naming)
+#define TRACE_PH_BEGIN   'B'
+#define TRACE_PH_END     'E'
+#define TRACE_PH_INSTANT 'i'
+
+// Serial commands (report when compiled out)
+void traceDump();
+void traceClear();
+
+#if TRACE_MODE
+
+void traceEvent(const char* name, char phase, uint16_t arg = 0);
+void traceState(int state);
+
+// Begin/End pair for the lifetime of a block
+struct TraceScope {
+  const char* name;
+  uint16_t arg;
+  TraceScope(const char* n, uint16_t a = 0) : name(n), arg(a) { traceEvent(name, TRACE_PH_BEGIN, arg); }
+  ~TraceScope() { traceEvent(name, TRACE_PH_END, arg); }
+};
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b)  TRACE_CAT2(a, b)
+
+// 'name' must be a string literal (only the pointer is stored)
+#define TRACE_BEGIN(name, arg)   traceEvent(name, TRACE_PH_BEGIN, arg)
+#define TRACE_END(name, arg)     traceEvent(name, TRACE_PH_END, arg)
+#define TRACE_INSTANT(name, arg) traceEvent(name, TRACE_PH_INSTANT, arg)
+#define TRACE_SCOPE(name, arg)   TraceScope TRACE_CAT(_traceScope, __LINE__)(name, arg)
+#define TRACE_STATE(state)       traceState(state)
+
+#else
+
+#define TRACE_BEGIN(name, arg)   ((void)0)
+#define TRACE_END(name, arg)     ((void)0)
+#define TRACE_INSTANT(name, arg) ((void)0)
+#define TRACE_SCOPE(name, arg)   ((void)0)
+#define TRACE_STATE(state)       ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Chameleon Ultra - Bluetooth BLE control from ESP32 device
+ * by PivotChip Security
+ *
+ * Host test for the Codec.h kernels against scalar references.
+ *
+ *   g++ -O2 -I. tools/codec_test.cpp Codec.cpp -o codec_test && ./codec_test
+ *
+ * Exits non-zero on any mismatch.
+ */
+
+#include "Codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ITERATIONS 20000
+#define TEST_MAX_LEN    300
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, size_t x, size_t y) {
+  if (ok) return;
+  if (failures < 20) printf("FAIL %s (%u, %u)\n", what, (unsigned)x, (unsigned)y);
+  failures++;
+}
+
+// --- Scalar references ---
+static void refHex(char* out, const uint8_t* data, size_t len, char sep) {
+  char* p = out;
+  for (size_t i = 0; i < len; i++) {
+    p += sprintf(p, "%02x", data[i]);
+    if (sep && i < len - 1) *p++ = sep;
+  }
+  *p = '\0';
+}
+
+static uint8_t refLRC(const uint8_t* data, size_t len) {
+  uint8_t sum = 0;
+  for (size_t i = 0; i < len; i++) sum += data[i];
+  return (uint8_t)(-sum);
+}
+
+static int refNibble(int c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Random lengths and source alignments through every kernel
+static void testRoundTrip() {
+  static uint8_t src[TEST_MAX_LEN + 4];
+  static uint8_t dst[TEST_MAX_LEN + 4];
+  static char hex[TEST_MAX_LEN * 3 + 1];
+  static char ref[TEST_MAX_LEN * 3 + 1];
+
+  for (int it = 0; it < TEST_ITERATIONS; it++) {
+    size_t len = rand() % TEST_MAX_LEN;
+    size_t off = rand() % 4;
+    for (size_t i = 0; i < sizeof(src); i++) src[i] = (uint8_t)rand();
+    const uint8_t* d = &src[off];
+
+    const char seps[] = {' ', ':', 0};
+    for (size_t s = 0; s < sizeof(seps); s++) {
+      size_t n = hexEncode(hex, d, len, seps[s]);
+      refHex(ref, d, len, seps[s]);
+      check(strcmp(hex, ref) == 0, "hexEncode", len, off);
+      check(n == HEX_ENCODED_LEN(len, seps[s]) && n == strlen(ref), "hexEncode length", len, off);
+      check(hexDecode(dst, TEST_MAX_LEN, hex, n) == (int)len && memcmp(dst, d, len) == 0, "hexDecode", len, off);
+    }
+
+    // Uppercase input
+    size_t n = hexEncode(hex, d, len, 0);
+    for (size_t i = 0; i < n; i++) if (hex[i] >= 'a') hex[i] -= 'a' - 'A';
+    check(hexDecode(dst, TEST_MAX_LEN, hex, n) == (int)len && memcmp(dst, d, len) == 0, "hexDecode upper", len, off);
+
+    // Odd digit count and overflow
+    if (len > 0) {
+      check(hexDecode(dst, TEST_MAX_LEN, hex, n - 1) == -1, "hexDecode odd", len, off);
+      check(hexDecode(dst, len - 1, hex, n) == -1, "hexDecode overflow", len, off);
+    }
+
+    check(lrcCalc(d, len) == refLRC(d, len), "lrcCalc", len, off);
+    memset(dst, 0, sizeof(dst));
+    check(lrcCopy(&dst[off], d, len) == refLRC(d, len) && memcmp(&dst[off], d, len) == 0, "lrcCopy", len, off);
+  }
+}
+
+// Every two-character input, alone (scalar path) and padded to a word (SWAR path)
+static void testAllDigitPairs() {
+  for (int a = 0; a < 256; a++) {
+    for (int b = 0; b < 256; b++) {
+      if (a == ' ' || a == ':' || b == ' ' || b == ':') continue;  // Separators, skipped by design
+      bool valid = refNibble(a) >= 0 && refNibble(b) >= 0;
+      uint8_t expect = (uint8_t)((refNibble(a) << 4) | refNibble(b));
+      uint8_t out[2];
+
+      char pair[2] = {(char)a, (char)b};
+      int r = hexDecode(out, sizeof(out), pair, 2);
+      check(valid ? (r == 1 && out[0] == expect) : r == -1, "hexDecode pair", a, b);
+
+      char word[4] = {(char)a, (char)b, '0', 'f'};
+      r = hexDecode(out, sizeof(out), word, 4);
+      check(valid ? (r == 2 && out[0] == expect && out[1] == 0x0f) : r == -1, "hexDecode word", a, b);
+
+      char tail[4] = {'f', '0', (char)a, (char)b};
+      r = hexDecode(out, sizeof(out), tail, 4);
+      check(valid ? (r == 2 && out[0] == 0xf0 && out[1] == expect) : r == -1, "hexDecode word tail", a, b);
+    }
+  }
+}
+
+int main() {
+  srand(1);
+  testRoundTrip();
+  testAllDigitPairs();
+  printf("codec_test: %d failure(s)\n", failures);
+  return failures ? 1 : 0;
+}
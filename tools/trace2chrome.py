@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Convert a 'trace dump' serial capture into Chrome trace JSON.
+
+Usage:
+    python3 trace2chrome.py capture.txt > trace.json
+
+Open the result in chrome://tracing or https://ui.perfetto.dev.
+Requires TRACE_MODE true in Shared.h.
+"""
+
+import json
+import sys
+
+
+def parse(lines):
+    events = []
+    inside = False
+    last_ts = None
+    wrap = 0
+
+    for raw in lines:
+        line = raw.strip()
+        # logOutput lines carry a "[millis] " prefix
+        pos = line.find("TRACE ")
+        if pos < 0:
+            continue
+        fields = line[pos:].split(" ", 5)
+
+        if fields[1] == "BEGIN":
+            inside = True
+            events = []
+            last_ts = None
+            wrap = 0
+            continue
+        if fields[1] == "END":
+            inside = False
+            continue
+        if not inside or len(fields) < 6:
+            continue
+
+        ts = int(fields[1])
+        # Device timestamps are 32-bit microseconds. Only a large backward
+        # step is a wrap; small ones are events from the other core.
+        if last_ts is not None and last_ts - ts > 1 << 31:
+            wrap += 1 << 32
+        last_ts = ts
+
+        event = {
+            "name": fields[5],
+            "ph": fields[2],
+            "ts": ts + wrap,
+            "pid": 0,
+            "tid": int(fields[3]),
+            "args": {"arg": int(fields[4])},
+        }
+        if event["ph"] == "i":
+            event["s"] = "t"
+        events.append(event)
+
+    return events
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "r", errors="replace") as f:
+            events = parse(f)
+    else:
+        events = parse(sys.stdin)
+
+    meta = [
+        {"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "ESP32 Chameleon Bridge"}},
+        {"name": "thread_name", "ph": "M", "pid": 0, "tid": 0, "args": {"name": "Core 0"}},
+        {"name": "thread_name", "ph": "M", "pid": 0, "tid": 1, "args": {"name": "Core 1"}},
+    ]
+    json.dump({"traceEvents": meta + events, "displayTimeUnit": "ms"}, sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()